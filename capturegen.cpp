@@ -0,0 +1,97 @@
+// Writes a small deterministic frame capture without a window or a GPU, for the
+// FrameReplay regression check. The scene is built and stepped on one thread at a
+// fixed timestep, so the same build always produces the same file.
+//
+//   CaptureGen out.bin [instanceCount] [frameCount]
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "SDL3/SDL_log.h"
+#include "framecapture.h"
+#include "scene.h"
+#include "simulation.h"
+
+constexpr uint32_t DEFAULT_INSTANCE_COUNT = 1024;
+constexpr uint32_t DEFAULT_FRAME_COUNT = 4;
+constexpr uint32_t CAPTURE_WIDTH = 640;
+constexpr uint32_t CAPTURE_HEIGHT = 360;
+constexpr float ORBIT_RADIUS = 350.0f;
+constexpr float ORBIT_HEIGHT = 50.0f;
+
+// Fills the snapshot like the simulation thread does, without the triple buffering
+static uint32_t FillSnapshot(Scene& scene, Query& query, SimSnapshot* snapshot) {
+    uint32_t count = 0;
+    scene.world.ForEachChunk(query, [&](ChunkView& chunk) {
+        const uint32_t rows = SDL_min(chunk.Count(), snapshot->capacity - count);
+        CopyChunkToSnapshot(chunk, snapshot, count, rows);
+        count += rows;
+    });
+    snapshot->instanceCount = count;
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: CaptureGen out.bin [instanceCount] [frameCount]\n");
+        return 1;
+    }
+    const char* path = argv[1];
+    const uint32_t instanceCount = argc > 2 ? (uint32_t) strtoul(argv[2], nullptr, 10) : DEFAULT_INSTANCE_COUNT;
+    const uint32_t frameCount = argc > 3 ? (uint32_t) strtoul(argv[3], nullptr, 10) : DEFAULT_FRAME_COUNT;
+    if (instanceCount == 0 || frameCount == 0) {
+        fprintf(stderr, "instanceCount and frameCount must be positive\n");
+        return 1;
+    }
+
+    // No workers, the respawn order and so the file only depend on the scene size
+    Scene* scene = new Scene(0);
+    InitScene(*scene, instanceCount);
+    Query query;
+    query.all = MaskOf<Position, Rotation, Scale, PreviousTransform, MeshInstance>();
+
+    std::vector<float> streams((size_t) instanceCount * SNAPSHOT_STREAM_COUNT);
+    std::vector<uint32_t> meshIds(instanceCount);
+    SimSnapshot snapshot = {};
+    snapshot.capacity = instanceCount;
+    for (uint32_t s = 0; s < SNAPSHOT_STREAM_COUNT; s++) {
+        snapshot.streams[s] = streams.data() + (size_t) instanceCount * s;
+    }
+    snapshot.meshIds = meshIds.data();
+
+    FrameCapture* capture = new FrameCapture();
+    BeginCapture(capture, path, frameCount, instanceCount);
+    const float dt = 1.0f / (float) SIM_TICK_RATE;
+    const float clearColor[3] = {0.1f, 0.1f, 0.1f};
+    bool ok = true;
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+        StorePreviousTransforms(*scene);
+        UpdateScene(*scene, dt);
+        FillSnapshot(*scene, query, &snapshot);
+
+        const float angle = 0.1f * dt * (float) frame;
+        const Camera camera = {
+            .position = {ORBIT_RADIUS * SDL_sinf(angle), ORBIT_HEIGHT, ORBIT_RADIUS * SDL_cosf(angle)},
+            .target = {0.0f, 0.0f, 0.0f},
+            .fovY = 1.0f,
+            .nearPlane = 0.1f,
+            .farPlane = 2000.0f
+        };
+        CaptureBeginFrame(capture, frame, CAPTURE_WIDTH, CAPTURE_HEIGHT);
+        CaptureUpdateInstances(capture, &snapshot, 0.5f, camera, (float) CAPTURE_WIDTH / (float) CAPTURE_HEIGHT);
+        CaptureSimpleCommand(capture, CaptureCommand::Cull);
+        CaptureBeginRenderPass(capture, clearColor);
+        CaptureSimpleCommand(capture, CaptureCommand::DrawScene);
+        CaptureSimpleCommand(capture, CaptureCommand::EndRenderPass);
+        ok &= CaptureEndFrame(capture);
+    }
+    ok = ok && capture->writer.Wait();
+
+    delete capture;
+    delete scene;
+    if (!ok) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to write %s", path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,354 @@
+#include "ecs.h"
+#include <atomic>
+#include <cstring>
+#include "SDL3/SDL_log.h"
+#include "SDL3/SDL_stdinc.h"
+
+constexpr uint32_t PENDING_GENERATION = UINT32_MAX;
+
+static std::atomic<uint32_t> componentTypeCount{0};
+static uint32_t componentFieldCounts[MAX_COMPONENT_TYPES];
+
+uint32_t RegisterComponentType(uint32_t size) {
+    const uint32_t id = componentTypeCount.fetch_add(1);
+    if (id >= MAX_COMPONENT_TYPES) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Too many component types, limit is %u", MAX_COMPONENT_TYPES);
+        SDL_assert_always(false);
+    }
+    componentFieldCounts[id] = size / 4;
+    return id;
+}
+
+uint32_t ComponentFieldCount(uint32_t componentId) {
+    return componentFieldCounts[componentId];
+}
+
+// Copies every field of one component between two rows, possibly in different archetypes
+static void CopyComponent(const Archetype* dst, const Chunk& dstChunk, uint32_t dstRow,
+                          const Archetype* src, const Chunk& srcChunk, uint32_t srcRow, uint32_t componentId) {
+    const uint32_t fieldCount = componentFieldCounts[componentId];
+    uint32_t* dstStream = (uint32_t*) (dstChunk.data + dst->streamOffset[componentId]);
+    const uint32_t* srcStream = (const uint32_t*) (srcChunk.data + src->streamOffset[componentId]);
+
+    for (uint32_t f = 0; f < fieldCount; f++) {
+        dstStream[f * dst->capacity + dstRow] = srcStream[f * src->capacity + srcRow];
+    }
+}
+
+World::~World() {
+    for (Archetype* archetype : archetypes) {
+        for (Chunk& chunk : archetype->chunks) {
+            FreeChunkData(chunk.data, archetype->chunkBytes);
+        }
+        delete archetype;
+    }
+    for (uint8_t* data : freeChunks) {
+        SDL_aligned_free(data);
+    }
+}
+
+uint8_t* World::AllocateChunkData(uint32_t bytes) {
+    if (bytes == ECS_CHUNK_SIZE && !freeChunks.empty()) {
+        uint8_t* data = freeChunks.back();
+        freeChunks.pop_back();
+        return data;
+    }
+    return (uint8_t*) SDL_aligned_alloc(ECS_CHUNK_ALIGNMENT, bytes);
+}
+
+void World::FreeChunkData(uint8_t* data, uint32_t bytes) {
+    if (bytes == ECS_CHUNK_SIZE) {
+        freeChunks.push_back(data);
+    }
+    else {
+        SDL_aligned_free(data);
+    }
+}
+
+uint32_t World::GetOrCreateArchetype(ComponentMask mask) {
+    auto found = archetypeLookup.find(mask);
+    if (found != archetypeLookup.end()) {
+        return found->second;
+    }
+
+    Archetype* archetype = new Archetype();
+    archetype->mask = mask;
+
+    uint32_t bytesPerRow = sizeof(Entity);
+    for (uint32_t id = 0; id < MAX_COMPONENT_TYPES; id++) {
+        archetype->streamOffset[id] = UINT32_MAX;
+        if (mask & (ComponentMask(1) << id)) {
+            archetype->componentIds.push_back(id);
+            bytesPerRow += componentFieldCounts[id] * 4;
+        }
+    }
+
+    // Round down to the lane width so every stream stays SIMD aligned; very wide
+    // archetypes get an oversized chunk rather than fewer than one lane of rows.
+    uint32_t capacity = (ECS_CHUNK_SIZE / bytesPerRow) & ~(ECS_LANE_WIDTH - 1);
+    if (capacity == 0) {
+        capacity = ECS_LANE_WIDTH;
+    }
+    archetype->capacity = capacity;
+
+    uint32_t offset = capacity * sizeof(Entity);
+    for (uint32_t id : archetype->componentIds) {
+        archetype->streamOffset[id] = offset;
+        offset += componentFieldCounts[id] * 4 * capacity;
+    }
+    archetype->chunkBytes = offset <= ECS_CHUNK_SIZE ? ECS_CHUNK_SIZE : offset;
+
+    const uint32_t index = (uint32_t) archetypes.size();
+    archetypes.push_back(archetype);
+    archetypeLookup.emplace(mask, index);
+    layoutVersion++;
+    return index;
+}
+
+// Appends the entity as a new zeroed row at the end of the archetype
+void World::PlaceEntity(uint32_t index, uint32_t archetypeIndex) {
+    Archetype* archetype = archetypes[archetypeIndex];
+
+    if (archetype->chunks.empty() || archetype->chunks.back().count == archetype->capacity) {
+        archetype->chunks.push_back(Chunk{AllocateChunkData(archetype->chunkBytes), 0});
+        layoutVersion++;
+    }
+
+    const uint32_t chunkIndex = (uint32_t) archetype->chunks.size() - 1;
+    Chunk& chunk = archetype->chunks[chunkIndex];
+    const uint32_t row = chunk.count++;
+
+    ((Entity*) chunk.data)[row] = Entity{index, records[index].generation};
+    for (uint32_t id : archetype->componentIds) {
+        uint32_t* stream = (uint32_t*) (chunk.data + archetype->streamOffset[id]);
+        for (uint32_t f = 0; f < componentFieldCounts[id]; f++) {
+            stream[f * archetype->capacity + row] = 0;
+        }
+    }
+
+    EntityRecord& record = records[index];
+    record.archetype = archetypeIndex;
+    record.chunk = chunkIndex;
+    record.row = row;
+}
+
+// Fills the hole with the archetype's last row so chunks stay densely packed
+void World::RemoveRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row) {
+    Archetype* archetype = archetypes[archetypeIndex];
+    Chunk& chunk = archetype->chunks[chunkIndex];
+    Chunk& last = archetype->chunks.back();
+    const uint32_t lastRow = last.count - 1;
+
+    if (&chunk != &last || row != lastRow) {
+        const Entity moved = ((Entity*) last.data)[lastRow];
+        ((Entity*) chunk.data)[row] = moved;
+        for (uint32_t id : archetype->componentIds) {
+            CopyComponent(archetype, chunk, row, archetype, last, lastRow, id);
+        }
+        records[moved.index].chunk = chunkIndex;
+        records[moved.index].row = row;
+    }
+
+    last.count--;
+    if (last.count == 0) {
+        FreeChunkData(last.data, archetype->chunkBytes);
+        archetype->chunks.pop_back();
+        layoutVersion++;
+    }
+}
+
+void World::MoveEntity(uint32_t index, ComponentMask newMask) {
+    const EntityRecord old = records[index];
+    if (archetypes[old.archetype]->mask == newMask) {
+        return;
+    }
+
+    const uint32_t newArchetype = GetOrCreateArchetype(newMask);
+    PlaceEntity(index, newArchetype);
+
+    const Archetype* src = archetypes[old.archetype];
+    const Archetype* dst = archetypes[newArchetype];
+    const EntityRecord& placed = records[index];
+    for (uint32_t id : dst->componentIds) {
+        if (src->mask & (ComponentMask(1) << id)) {
+            CopyComponent(dst, dst->chunks[placed.chunk], placed.row, src, src->chunks[old.chunk], old.row, id);
+        }
+    }
+
+    RemoveRow(old.archetype, old.chunk, old.row);
+}
+
+Entity World::CreateEntity(ComponentMask mask) {
+    uint32_t index;
+    if (!freeIndices.empty()) {
+        index = freeIndices.back();
+        freeIndices.pop_back();
+    }
+    else {
+        index = (uint32_t) records.size();
+        records.push_back(EntityRecord{0, 0, 0, 1});
+    }
+
+    PlaceEntity(index, GetOrCreateArchetype(mask));
+    aliveCount++;
+    return Entity{index, records[index].generation};
+}
+
+bool World::IsAlive(Entity entity) const {
+    return entity.index < records.size()
+        && records[entity.index].generation == entity.generation
+        && entity.generation != PENDING_GENERATION;
+}
+
+void World::DestroyEntity(Entity entity) {
+    if (!IsAlive(entity)) return;
+
+    EntityRecord& record = records[entity.index];
+    RemoveRow(record.archetype, record.chunk, record.row);
+
+    record.generation++;
+    if (record.generation == PENDING_GENERATION) {
+        record.generation = 1;
+    }
+    freeIndices.push_back(entity.index);
+    aliveCount--;
+}
+
+void World::AddComponents(Entity entity, ComponentMask mask) {
+    if (!IsAlive(entity)) return;
+    MoveEntity(entity.index, archetypes[records[entity.index].archetype]->mask | mask);
+}
+
+void World::RemoveComponents(Entity entity, ComponentMask mask) {
+    if (!IsAlive(entity)) return;
+    MoveEntity(entity.index, archetypes[records[entity.index].archetype]->mask & ~mask);
+}
+
+ComponentMask World::MaskOfEntity(Entity entity) const {
+    if (!IsAlive(entity)) return 0;
+    return archetypes[records[entity.index].archetype]->mask;
+}
+
+void World::WriteComponent(Entity entity, uint32_t componentId, const void* value) {
+    if (!IsAlive(entity)) return;
+
+    const EntityRecord& record = records[entity.index];
+    const Archetype* archetype = archetypes[record.archetype];
+    if (archetype->streamOffset[componentId] == UINT32_MAX) {
+        SDL_Log("WriteComponent: entity %u has no component %u", entity.index, componentId);
+        return;
+    }
+
+    uint32_t* stream = (uint32_t*) (archetype->chunks[record.chunk].data + archetype->streamOffset[componentId]);
+    const uint32_t* fields = (const uint32_t*) value;
+    for (uint32_t f = 0; f < componentFieldCounts[componentId]; f++) {
+        stream[f * archetype->capacity + record.row] = fields[f];
+    }
+}
+
+void World::ReadComponent(Entity entity, uint32_t componentId, void* value) const {
+    uint32_t* fields = (uint32_t*) value;
+    const uint32_t fieldCount = componentFieldCounts[componentId];
+
+    if (!IsAlive(entity) || archetypes[records[entity.index].archetype]->streamOffset[componentId] == UINT32_MAX) {
+        memset(fields, 0, fieldCount * 4);
+        return;
+    }
+
+    const EntityRecord& record = records[entity.index];
+    const Archetype* archetype = archetypes[record.archetype];
+    const uint32_t* stream = (const uint32_t*) (archetype->chunks[record.chunk].data + archetype->streamOffset[componentId]);
+    for (uint32_t f = 0; f < fieldCount; f++) {
+        fields[f] = stream[f * archetype->capacity + record.row];
+    }
+}
+
+void World::UpdateQuery(Query& query) {
+    if (query.layoutVersion == layoutVersion) {
+        return;
+    }
+
+    query.chunks.clear();
+    for (Archetype* archetype : archetypes) {
+        if ((archetype->mask & query.all) != query.all || (archetype->mask & query.none) != 0) {
+            continue;
+        }
+        for (Chunk& chunk : archetype->chunks) {
+            query.chunks.push_back(ChunkView{archetype, &chunk});
+        }
+    }
+    query.layoutVersion = layoutVersion;
+}
+
+void CommandBuffer::Push(const CommandHeader& header, const void* payload) {
+    const size_t offset = stream.size();
+    stream.resize(offset + sizeof(CommandHeader) + header.payloadSize);
+    memcpy(stream.data() + offset, &header, sizeof(CommandHeader));
+    if (payload) {
+        memcpy(stream.data() + offset + sizeof(CommandHeader), payload, header.payloadSize);
+    }
+}
+
+Entity CommandBuffer::CreateEntity(ComponentMask mask) {
+    const Entity placeholder = {pendingCount++, PENDING_GENERATION};
+    Push(CommandHeader{CommandType::Create, 0, placeholder, mask, 0, 0}, nullptr);
+    return placeholder;
+}
+
+void CommandBuffer::DestroyEntity(Entity entity) {
+    Push(CommandHeader{CommandType::Destroy, 0, entity, 0, 0, 0}, nullptr);
+}
+
+void CommandBuffer::AddComponents(Entity entity, ComponentMask mask) {
+    Push(CommandHeader{CommandType::Add, 0, entity, mask, 0, 0}, nullptr);
+}
+
+void CommandBuffer::RemoveComponents(Entity entity, ComponentMask mask) {
+    Push(CommandHeader{CommandType::Remove, 0, entity, mask, 0, 0}, nullptr);
+}
+
+void CommandBuffer::WriteComponent(Entity entity, uint32_t componentId, const void* value, uint32_t size) {
+    // Keep every header 8 byte aligned in the stream
+    const uint32_t paddedSize = (size + 7) & ~7u;
+    const size_t offset = stream.size();
+    Push(CommandHeader{CommandType::Write, componentId, entity, 0, paddedSize, 0}, nullptr);
+    memcpy(stream.data() + offset + sizeof(CommandHeader), value, size);
+}
+
+void CommandBuffer::Playback(World& world) {
+    resolved.resize(pendingCount);
+
+    size_t offset = 0;
+    while (offset < stream.size()) {
+        CommandHeader header;
+        memcpy(&header, stream.data() + offset, sizeof(CommandHeader));
+        const uint8_t* payload = stream.data() + offset + sizeof(CommandHeader);
+        offset += sizeof(CommandHeader) + header.payloadSize;
+
+        Entity entity = header.entity;
+        if (header.type != CommandType::Create && entity.generation == PENDING_GENERATION) {
+            entity = resolved[entity.index];
+        }
+
+        switch (header.type) {
+            case CommandType::Create:
+                resolved[entity.index] = world.CreateEntity(header.mask);
+                break;
+            case CommandType::Destroy:
+                world.DestroyEntity(entity);
+                break;
+            case CommandType::Add:
+                world.AddComponents(entity, header.mask);
+                break;
+            case CommandType::Remove:
+                world.RemoveComponents(entity, header.mask);
+                break;
+            case CommandType::Write:
+                world.WriteComponent(entity, header.componentId, payload);
+                break;
+        }
+    }
+
+    stream.clear();
+    pendingCount = 0;
+}
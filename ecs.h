@@ -0,0 +1,230 @@
+#ifndef ECS_H
+#define ECS_H
+
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "jobs.h"
+
+// Archetype based entity-component storage.
+//
+// Entities with the same set of components share an archetype. Each archetype
+// owns fixed size chunks, and every chunk stores its rows as structure-of-arrays:
+// one stream of entity handles followed by one stream per 4 byte component field.
+// A Position {x, y, z} therefore lives in three contiguous float arrays per chunk,
+// which is what the batched math kernels consume.
+//
+// Components must be trivially copyable and built from 4 byte fields.
+// Structural changes (create, destroy, add, remove) are only allowed from the
+// main thread while no query is running; systems running in parallel record them
+// into a CommandBuffer instead.
+
+constexpr uint32_t MAX_COMPONENT_TYPES = 64;
+constexpr uint32_t ECS_CHUNK_SIZE = 16 * 1024;
+constexpr uint32_t ECS_CHUNK_ALIGNMENT = 64;
+constexpr uint32_t ECS_LANE_WIDTH = 8; // chunk capacity is a multiple of this so kernels never need a tail inside a stream
+
+typedef uint64_t ComponentMask;
+
+struct Entity {
+    uint32_t index;
+    uint32_t generation;
+};
+
+constexpr Entity NULL_ENTITY = {UINT32_MAX, 0};
+
+inline bool operator==(const Entity a, const Entity b) {
+    return a.index == b.index && a.generation == b.generation;
+}
+
+uint32_t RegisterComponentType(uint32_t size);
+uint32_t ComponentFieldCount(uint32_t componentId);
+
+template<typename T>
+uint32_t ComponentId() {
+    static_assert(std::is_trivially_copyable_v<T>, "Components must be trivially copyable");
+    static_assert(sizeof(T) % 4 == 0 && alignof(T) <= 4, "Components must be made of 4 byte fields");
+    static const uint32_t id = RegisterComponentType(sizeof(T));
+    return id;
+}
+
+template<typename... Ts>
+ComponentMask MaskOf() {
+    return ((ComponentMask(1) << ComponentId<Ts>()) | ... | ComponentMask(0));
+}
+
+struct Chunk {
+    uint8_t* data;
+    uint32_t count;
+};
+
+struct Archetype {
+    ComponentMask mask;
+    uint32_t capacity;
+    uint32_t chunkBytes;
+    uint32_t streamOffset[MAX_COMPONENT_TYPES]; // byte offset of a component's first field stream, UINT32_MAX if absent
+    std::vector<uint32_t> componentIds;
+    std::vector<Chunk> chunks; // only the last chunk may be partially filled
+};
+
+struct ChunkView {
+    const Archetype* archetype;
+    Chunk* chunk;
+
+    uint32_t Count() const { return chunk->count; }
+    const Entity* Entities() const { return (const Entity*) chunk->data; }
+
+    template<typename T>
+    bool Has() const { return archetype->mask & MaskOf<T>(); }
+
+    // Contiguous stream holding field `field` of component T for every row in the chunk
+    template<typename T, typename F = float>
+    F* Field(uint32_t field) const {
+        static_assert(sizeof(F) == 4);
+        return (F*) (chunk->data + archetype->streamOffset[ComponentId<T>()] + field * archetype->capacity * 4);
+    }
+};
+
+// Cached list of chunks matching a component filter, refreshed lazily when the
+// world's chunk layout changes.
+struct Query {
+    ComponentMask all = 0;
+    ComponentMask none = 0;
+    uint64_t layoutVersion = UINT64_MAX;
+    std::vector<ChunkView> chunks;
+};
+
+class World {
+public:
+    World() = default;
+    ~World();
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    // New components are zero initialised
+    Entity CreateEntity(ComponentMask mask);
+    void DestroyEntity(Entity entity);
+    bool IsAlive(Entity entity) const;
+    void AddComponents(Entity entity, ComponentMask mask);
+    void RemoveComponents(Entity entity, ComponentMask mask);
+    ComponentMask MaskOfEntity(Entity entity) const;
+
+    void WriteComponent(Entity entity, uint32_t componentId, const void* value);
+    void ReadComponent(Entity entity, uint32_t componentId, void* value) const;
+
+    template<typename T>
+    void Set(Entity entity, const T& value) { WriteComponent(entity, ComponentId<T>(), &value); }
+
+    template<typename T>
+    T Get(Entity entity) const {
+        T value;
+        ReadComponent(entity, ComponentId<T>(), &value);
+        return value;
+    }
+
+    template<typename T>
+    bool Has(Entity entity) const { return MaskOfEntity(entity) & MaskOf<T>(); }
+
+    uint32_t EntityCount() const { return aliveCount; }
+
+    void UpdateQuery(Query& query);
+
+    template<typename Fn>
+    void ForEachChunk(Query& query, Fn&& fn) {
+        UpdateQuery(query);
+        for (ChunkView& view : query.chunks) {
+            fn(view);
+        }
+    }
+
+    // fn(ChunkView&, threadIndex) is called for every matching chunk across the job system.
+    // threadIndex is stable for the call and can index per-thread CommandBuffers.
+    template<typename Fn>
+    void ParallelForEachChunk(JobSystem& jobs, Query& query, Fn&& fn) {
+        UpdateQuery(query);
+        ChunkView* views = query.chunks.data();
+        jobs.ParallelFor((uint32_t) query.chunks.size(), 1, [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+            for (uint32_t i = begin; i < end; i++) {
+                fn(views[i], threadIndex);
+            }
+        });
+    }
+
+private:
+    struct EntityRecord {
+        uint32_t archetype;
+        uint32_t chunk;
+        uint32_t row;
+        uint32_t generation;
+    };
+
+    uint32_t GetOrCreateArchetype(ComponentMask mask);
+    void PlaceEntity(uint32_t index, uint32_t archetypeIndex);
+    void MoveEntity(uint32_t index, ComponentMask newMask);
+    void RemoveRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row);
+    uint8_t* AllocateChunkData(uint32_t bytes);
+    void FreeChunkData(uint8_t* data, uint32_t bytes);
+
+    std::vector<Archetype*> archetypes;
+    std::unordered_map<ComponentMask, uint32_t> archetypeLookup;
+    std::vector<EntityRecord> records;
+    std::vector<uint32_t> freeIndices;
+    std::vector<uint8_t*> freeChunks; // recycled ECS_CHUNK_SIZE blocks
+    uint32_t aliveCount = 0;
+    uint64_t layoutVersion = 0;
+};
+
+// Records structural changes so that systems can run concurrently and apply them
+// afterwards on the main thread. Entities created through a command buffer are
+// placeholders until Playback() resolves them; they may be used in later
+// commands of the same buffer. The byte stream keeps its capacity across frames.
+class CommandBuffer {
+public:
+    Entity CreateEntity(ComponentMask mask);
+    void DestroyEntity(Entity entity);
+    void AddComponents(Entity entity, ComponentMask mask);
+    void RemoveComponents(Entity entity, ComponentMask mask);
+    void WriteComponent(Entity entity, uint32_t componentId, const void* value, uint32_t size);
+
+    template<typename T>
+    void Set(Entity entity, const T& value) { WriteComponent(entity, ComponentId<T>(), &value, sizeof(T)); }
+
+    template<typename T>
+    void Add(Entity entity, const T& value) {
+        AddComponents(entity, MaskOf<T>());
+        Set(entity, value);
+    }
+
+    bool Empty() const { return stream.empty(); }
+
+    // Applies every recorded command in order, then clears the buffer
+    void Playback(World& world);
+
+private:
+    enum class CommandType : uint32_t {
+        Create,
+        Destroy,
+        Add,
+        Remove,
+        Write
+    };
+
+    struct CommandHeader {
+        CommandType type;
+        uint32_t componentId;
+        Entity entity;
+        ComponentMask mask;
+        uint32_t payloadSize;
+        uint32_t padding;
+    };
+
+    void Push(const CommandHeader& header, const void* payload);
+
+    std::vector<uint8_t> stream;
+    std::vector<Entity> resolved;
+    uint32_t pendingCount = 0;
+};
+
+#endif //ECS_H
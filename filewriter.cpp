@@ -0,0 +1,81 @@
+#include "filewriter.h"
+#include <cstdio>
+#include "SDL3/SDL_log.h"
+
+FileWriter::~FileWriter() {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+bool FileWriter::Submit(const char* filePath, const void* fileData, size_t fileSize) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending) {
+            return false;
+        }
+        path = filePath;
+        data = fileData;
+        size = fileSize;
+        pending = true;
+    }
+
+    if (!thread.joinable()) {
+        thread = std::thread(&FileWriter::WriterLoop, this);
+    }
+    wake.notify_one();
+    return true;
+}
+
+bool FileWriter::Busy() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+}
+
+bool FileWriter::Wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return !pending; });
+    return lastOk;
+}
+
+void FileWriter::WriterLoop() {
+    for (;;) {
+        const char* filePath;
+        const void* fileData;
+        size_t fileSize;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // A write submitted before shutdown still lands on disk
+            wake.wait(lock, [this] { return quit || pending; });
+            if (!pending) {
+                return;
+            }
+            filePath = path;
+            fileData = data;
+            fileSize = size;
+        }
+
+        bool ok = false;
+        FILE* file = fopen(filePath, "wb");
+        if (file) {
+            const bool written = fwrite(fileData, 1, fileSize, file) == fileSize;
+            ok = fclose(file) == 0 && written;
+        }
+        if (!ok) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to write %s", filePath);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            lastOk = ok;
+            pending = false;
+        }
+        done.notify_all();
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef FILEWRITER_H
+#define FILEWRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+// Writes whole files on a background thread so the frame never waits on fopen
+// or the disk. One write is in flight at a time: the caller keeps the buffer and
+// the path alive and untouched until Busy() returns false. The thread is started
+// by the first Submit.
+class FileWriter {
+public:
+    FileWriter() = default;
+    // Finishes the pending write, if any
+    ~FileWriter();
+
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    // Returns false without queuing anything while the previous write is still running
+    bool Submit(const char* path, const void* data, size_t size);
+    bool Busy();
+    // Blocks until the pending write has finished, returns whether the last write succeeded
+    bool Wait();
+
+private:
+    void WriterLoop();
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const char* path = nullptr;
+    const void* data = nullptr;
+    size_t size = 0;
+    bool pending = false;
+    bool lastOk = true;
+    bool quit = false;
+};
+
+#endif //FILEWRITER_H
@@ -0,0 +1,183 @@
+#include "framecapture.h"
+#include <cstdio>
+#include <cstring>
+#include "SDL3/SDL_log.h"
+
+static void AppendBytes(FrameCapture* capture, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*) data;
+    capture->stream.insert(capture->stream.end(), bytes, bytes + size);
+}
+
+static void AppendCommand(FrameCapture* capture, CaptureCommand command, const void* payload, uint32_t size) {
+    const CaptureCommandHeader header = {command, size};
+    AppendBytes(capture, &header, sizeof(header));
+    if (size > 0) {
+        AppendBytes(capture, payload, size);
+    }
+}
+
+size_t CaptureFrameBytes(uint32_t maxInstances) {
+    const size_t header = sizeof(CaptureCommandHeader);
+    const size_t instanceBytes = (sizeof(float) * SNAPSHOT_STREAM_COUNT + sizeof(uint32_t)) * maxInstances;
+    // BeginFrame, UpdateInstances, Cull, BeginRenderPass, DrawScene, EndRenderPass and EndFrame
+    return header * 7 + sizeof(BeginFrameCommand) + sizeof(UpdateInstancesCommand) + instanceBytes
+           + sizeof(BeginRenderPassCommand);
+}
+
+bool BeginCapture(FrameCapture* capture, const char* path, uint32_t frameCount, uint32_t maxInstances) {
+    if (capture->writer.Busy()) {
+        SDL_Log("The previous frame capture is still being written");
+        return false;
+    }
+
+    // One allocation up front, appending a frame never grows the stream
+    capture->stream.clear();
+    capture->stream.reserve(sizeof(CaptureFileHeader) + sizeof(CaptureCommandHeader) + sizeof(SceneSetupCommand)
+                            + CaptureFrameBytes(maxInstances) * frameCount);
+    capture->path = path;
+    capture->framesRemaining = frameCount;
+    capture->frameCount = frameCount;
+
+    const CaptureFileHeader header = {CAPTURE_MAGIC, CAPTURE_VERSION, frameCount, 0};
+    AppendBytes(capture, &header, sizeof(header));
+
+    const SceneSetupCommand setup = {maxInstances, 0};
+    AppendCommand(capture, CaptureCommand::SceneSetup, &setup, sizeof(setup));
+    return true;
+}
+
+bool IsCapturing(const FrameCapture* capture) {
+    return capture->framesRemaining > 0;
+}
+
+void CaptureBeginFrame(FrameCapture* capture, uint64_t frameNumber, uint32_t width, uint32_t height) {
+    const BeginFrameCommand frame = {frameNumber, width, height};
+    AppendCommand(capture, CaptureCommand::BeginFrame, &frame, sizeof(frame));
+}
+
+void CaptureUpdateInstances(FrameCapture* capture, const SimSnapshot* snapshot, float alpha, const Camera& camera,
+                            float aspect) {
+    const uint32_t count = snapshot->instanceCount;
+    const UpdateInstancesCommand instances = {camera, aspect, alpha, count};
+    const size_t streamBytes = sizeof(float) * count;
+    const size_t size = sizeof(instances) + streamBytes * SNAPSHOT_STREAM_COUNT + sizeof(uint32_t) * count;
+
+    const CaptureCommandHeader header = {CaptureCommand::UpdateInstances, (uint32_t) size};
+    AppendBytes(capture, &header, sizeof(header));
+    AppendBytes(capture, &instances, sizeof(instances));
+    for (uint32_t s = 0; s < SNAPSHOT_STREAM_COUNT; s++) {
+        AppendBytes(capture, snapshot->streams[s], streamBytes);
+    }
+    AppendBytes(capture, snapshot->meshIds, sizeof(uint32_t) * count);
+}
+
+void CaptureBeginRenderPass(FrameCapture* capture, const float clearColor[3]) {
+    const BeginRenderPassCommand pass = {{clearColor[0], clearColor[1], clearColor[2], 1.0f}};
+    AppendCommand(capture, CaptureCommand::BeginRenderPass, &pass, sizeof(pass));
+}
+
+void CaptureSimpleCommand(FrameCapture* capture, CaptureCommand command) {
+    AppendCommand(capture, command, nullptr, 0);
+}
+
+bool CaptureEndFrame(FrameCapture* capture) {
+    AppendCommand(capture, CaptureCommand::EndFrame, nullptr, 0);
+    if (--capture->framesRemaining > 0) {
+        return true;
+    }
+
+    if (!capture->writer.Submit(capture->path, capture->stream.data(), capture->stream.size())) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to queue the frame capture for %s", capture->path);
+        return false;
+    }
+    SDL_Log("Writing %u captured frames to %s (%.1f MiB)", capture->frameCount, capture->path,
+            (double) capture->stream.size() / (1024.0 * 1024.0));
+    return true;
+}
+
+bool LoadCapture(const char* path, std::vector<uint8_t>& data, CaptureFileHeader* header, CaptureReader* reader) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to open capture %s", path);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < (long) sizeof(CaptureFileHeader)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s is too small to be a capture", path);
+        fclose(file);
+        return false;
+    }
+
+    data.resize((size_t) size);
+    const bool read = fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    if (!read) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to read capture %s", path);
+        return false;
+    }
+
+    memcpy(header, data.data(), sizeof(CaptureFileHeader));
+    if (header->magic != CAPTURE_MAGIC || header->version != CAPTURE_VERSION) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s is not a version %u capture", path, CAPTURE_VERSION);
+        return false;
+    }
+
+    reader->data = data.data();
+    reader->size = data.size();
+    reader->offset = sizeof(CaptureFileHeader);
+    reader->truncated = false;
+    return true;
+}
+
+bool NextCaptureCommand(CaptureReader* reader, CaptureCommandHeader* header, const uint8_t** payload) {
+    if (reader->truncated || reader->offset == reader->size) {
+        return false;
+    }
+    if (reader->size - reader->offset < sizeof(CaptureCommandHeader)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Capture truncated inside a command header");
+        reader->truncated = true;
+        return false;
+    }
+    memcpy(header, reader->data + reader->offset, sizeof(CaptureCommandHeader));
+    reader->offset += sizeof(CaptureCommandHeader);
+
+    if (reader->size - reader->offset < header->size) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Capture truncated inside command %u", (uint32_t) header->command);
+        reader->truncated = true;
+        return false;
+    }
+    *payload = reader->data + reader->offset;
+    reader->offset += header->size;
+    return true;
+}
+
+bool CaptureInstancesSnapshot(const uint8_t* payload, uint32_t size, UpdateInstancesCommand* instances,
+                              SimSnapshot* snapshot) {
+    if (size < sizeof(UpdateInstancesCommand)) {
+        return false;
+    }
+    memcpy(instances, payload, sizeof(UpdateInstancesCommand));
+
+    const uint32_t count = instances->instanceCount;
+    const size_t streamBytes = sizeof(float) * count;
+    if (size != sizeof(UpdateInstancesCommand) + streamBytes * SNAPSHOT_STREAM_COUNT + sizeof(uint32_t) * count) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "UpdateInstances payload does not match %u instances", count);
+        return false;
+    }
+
+    memset(snapshot, 0, sizeof(SimSnapshot));
+    snapshot->previousCamera = instances->camera;
+    snapshot->camera = instances->camera;
+    snapshot->instanceCount = count;
+    snapshot->capacity = count;
+
+    const uint8_t* streams = payload + sizeof(UpdateInstancesCommand);
+    for (uint32_t s = 0; s < SNAPSHOT_STREAM_COUNT; s++) {
+        snapshot->streams[s] = (float*) (streams + streamBytes * s);
+    }
+    snapshot->meshIds = (uint32_t*) (streams + streamBytes * SNAPSHOT_STREAM_COUNT);
+    return true;
+}
@@ -0,0 +1,106 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "filewriter.h"
+#include "scene.h"
+#include "simulation.h"
+
+// Frame capture stream.
+//
+// A capture is the sequence of engine-level render commands issued for a few
+// frames, with the data they consumed, so FrameReplay can rebuild the exact same
+// GPU workload without a window or a simulation. The file is a
+// CaptureFileHeader followed by commands, each a CaptureCommandHeader and
+// `size` bytes of payload. Everything is little endian and 4 byte aligned.
+
+constexpr uint32_t CAPTURE_MAGIC = 0x50414346; // "FCAP"
+constexpr uint32_t CAPTURE_VERSION = 1;
+
+enum class CaptureCommand : uint32_t {
+    SceneSetup,      // SceneSetupCommand, GPU scene resources and pipelines
+    BeginFrame,      // BeginFrameCommand
+    UpdateInstances, // UpdateInstancesCommand then SNAPSHOT_STREAM_COUNT float streams and the mesh ids
+    Cull,            // RecordGpuCulling, including its barriers
+    BeginRenderPass, // BeginRenderPassCommand
+    DrawScene,       // RecordGpuDraw
+    EndRenderPass,
+    EndFrame
+};
+
+struct CaptureFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frameCount;
+    uint32_t reserved;
+};
+
+struct CaptureCommandHeader {
+    CaptureCommand command;
+    uint32_t size;
+};
+
+struct SceneSetupCommand {
+    uint32_t maxInstances;
+    uint32_t reserved;
+};
+
+struct BeginFrameCommand {
+    uint64_t frameNumber;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct UpdateInstancesCommand {
+    Camera camera;
+    float aspect;
+    float alpha;
+    uint32_t instanceCount;
+};
+
+struct BeginRenderPassCommand {
+    float clearColor[4];
+};
+
+struct FrameCapture {
+    std::vector<uint8_t> stream; // sized for every frame by BeginCapture, kept for the next capture
+    const char* path;
+    uint32_t framesRemaining;
+    uint32_t frameCount;
+    FileWriter writer;           // owns stream while the file is being written
+};
+
+// Stream bytes for one frame of at most maxInstances instances
+size_t CaptureFrameBytes(uint32_t maxInstances);
+
+// Starts buffering the next frameCount frames, the file is written on a background
+// thread after the last EndFrame. Returns false while the previous capture is still being written.
+bool BeginCapture(FrameCapture* capture, const char* path, uint32_t frameCount, uint32_t maxInstances);
+bool IsCapturing(const FrameCapture* capture);
+
+void CaptureBeginFrame(FrameCapture* capture, uint64_t frameNumber, uint32_t width, uint32_t height);
+void CaptureUpdateInstances(FrameCapture* capture, const SimSnapshot* snapshot, float alpha, const Camera& camera, float aspect);
+void CaptureBeginRenderPass(FrameCapture* capture, const float clearColor[3]);
+// Commands without payload: Cull, DrawScene, EndRenderPass
+void CaptureSimpleCommand(FrameCapture* capture, CaptureCommand command);
+// Hands the stream to the writer after the last frame, returns false if that failed
+bool CaptureEndFrame(FrameCapture* capture);
+
+struct CaptureReader {
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+    bool truncated;
+};
+
+// Reads and validates a capture file, the reader points into data
+bool LoadCapture(const char* path, std::vector<uint8_t>& data, CaptureFileHeader* header, CaptureReader* reader);
+// Returns false at the end of the stream, or on a truncated command with reader->truncated set
+bool NextCaptureCommand(CaptureReader* reader, CaptureCommandHeader* header, const uint8_t** payload);
+
+// Points a snapshot at the streams of an UpdateInstances payload without copying
+bool CaptureInstancesSnapshot(const uint8_t* payload, uint32_t size, UpdateInstancesCommand* instances, SimSnapshot* snapshot);
+
+#endif //FRAMECAPTURE_H
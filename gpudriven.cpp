@@ -0,0 +1,560 @@
+#include "gpudriven.h"
+#include <cstddef>
+#include <cstring>
+#include "SDL3/SDL_log.h"
+#include "SDL3/SDL_stdinc.h"
+#include "mathkernels.h"
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// UV sphere of unit radius, one LOD per entry in `segments`. Triangles wind
+// counter-clockwise seen from outside.
+static void BuildSphereMesh(GpuScene* gpuScene, const uint32_t* segments, const float* maxDistances, uint32_t lodCount) {
+    GpuMeshInfo& mesh = gpuScene->meshes[gpuScene->meshCount++];
+    mesh = {};
+    mesh.boundingSphere = {0.0f, 0.0f, 0.0f, 1.0f};
+    mesh.lodCount = lodCount;
+
+    for (uint32_t lod = 0; lod < lodCount; lod++) {
+        const uint32_t slices = segments[lod];
+        const uint32_t rings = slices / 2;
+        const int32_t vertexOffset = (int32_t) gpuScene->vertices.size();
+        const uint32_t firstIndex = (uint32_t) gpuScene->indices.size();
+
+        for (uint32_t r = 0; r <= rings; r++) {
+            const float theta = SDL_PI_F * (float) r / (float) rings;
+            for (uint32_t s = 0; s <= slices; s++) {
+                const float phi = 2.0f * SDL_PI_F * (float) s / (float) slices;
+                const Vec3 p = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+                gpuScene->vertices.push_back(MeshVertex{{p.x, p.y, p.z}, {p.x, p.y, p.z}});
+            }
+        }
+
+        for (uint32_t r = 0; r < rings; r++) {
+            for (uint32_t s = 0; s < slices; s++) {
+                const uint32_t a = r * (slices + 1) + s;
+                const uint32_t b = a + slices + 1;
+                const uint32_t c = a + 1;
+                const uint32_t d = b + 1;
+                if (r != 0) {
+                    gpuScene->indices.insert(gpuScene->indices.end(), {a, c, b});
+                }
+                if (r != rings - 1) {
+                    gpuScene->indices.insert(gpuScene->indices.end(), {c, d, b});
+                }
+            }
+        }
+
+        mesh.lods[lod] = GpuMeshLod{
+            (uint32_t) gpuScene->indices.size() - firstIndex,
+            firstIndex,
+            vertexOffset,
+            maxDistances[lod]
+        };
+    }
+}
+
+static bool CreateDescriptors(GpuScene* gpuScene, VulkanContext* context) {
+    VkDescriptorSetLayoutBinding bindings[8];
+    for (uint32_t i = 0; i < 8; i++) {
+        bindings[i] = VkDescriptorSetLayoutBinding{
+            .binding = i,
+            .descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT
+        };
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 8,
+        .pBindings = bindings
+    };
+    if (vkCreateDescriptorSetLayout(context->device, &layoutInfo, nullptr, &gpuScene->setLayout) != VK_SUCCESS) {
+        SDL_Log("Create Descriptor Set Layout Failed");
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSizes[2] = {
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_FRAMES_IN_FLIGHT},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7 * MAX_FRAMES_IN_FLIGHT}
+    };
+    VkDescriptorPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = MAX_FRAMES_IN_FLIGHT,
+        .poolSizeCount = 2,
+        .pPoolSizes = poolSizes
+    };
+    if (vkCreateDescriptorPool(context->device, &poolInfo, nullptr, &gpuScene->descriptorPool) != VK_SUCCESS) {
+        SDL_Log("Create Descriptor Pool Failed");
+        return false;
+    }
+
+    VkDescriptorSetLayout layouts[MAX_FRAMES_IN_FLIGHT];
+    VkDescriptorSet sets[MAX_FRAMES_IN_FLIGHT];
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        layouts[i] = gpuScene->setLayout;
+    }
+    VkDescriptorSetAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = gpuScene->descriptorPool,
+        .descriptorSetCount = MAX_FRAMES_IN_FLIGHT,
+        .pSetLayouts = layouts
+    };
+    if (vkAllocateDescriptorSets(context->device, &allocateInfo, sets) != VK_SUCCESS) {
+        SDL_Log("Allocate Descriptor Sets Failed");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        GpuFrameSlot& slot = gpuScene->frames[i];
+        slot.descriptorSet = sets[i];
+
+        const VkDescriptorBufferInfo bufferInfos[8] = {
+            {slot.buffer, 0, sizeof(GpuFrameData)},
+            {slot.buffer, gpuScene->modelsOffset, sizeof(Mat4) * gpuScene->maxInstances},
+            {slot.buffer, gpuScene->meshIdsOffset, sizeof(uint32_t) * gpuScene->maxInstances},
+            {gpuScene->meshBuffer, 0, VK_WHOLE_SIZE},
+            {gpuScene->bucketCountBuffer, 0, VK_WHOLE_SIZE},
+            {gpuScene->visibleBuffer, 0, VK_WHOLE_SIZE},
+            {gpuScene->drawCommandBuffer, 0, VK_WHOLE_SIZE},
+            {gpuScene->drawCountBuffer, 0, VK_WHOLE_SIZE}
+        };
+
+        VkWriteDescriptorSet writes[8];
+        for (uint32_t b = 0; b < 8; b++) {
+            writes[b] = VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = slot.descriptorSet,
+                .dstBinding = b,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = bindings[b].descriptorType,
+                .pBufferInfo = &bufferInfos[b]
+            };
+        }
+        vkUpdateDescriptorSets(context->device, 8, writes, 0, nullptr);
+    }
+
+    // Base added to gl_InstanceIndex, only non-zero on the per-bucket draw path
+    VkPushConstantRange pushConstantRange = {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(uint32_t)
+    };
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &gpuScene->setLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    };
+    if (vkCreatePipelineLayout(context->device, &pipelineLayoutInfo, nullptr, &gpuScene->pipelineLayout) != VK_SUCCESS) {
+        SDL_Log("Create Pipeline Layout Failed");
+        return false;
+    }
+
+    return true;
+}
+
+static bool CreateComputePipeline(GpuScene* gpuScene, VulkanContext* context, const char* path, VkPipeline* pipeline) {
+    VkShaderModule module = LoadShaderModule(&context->device, path);
+
+    VkComputePipelineCreateInfo pipelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = module,
+            .pName = "main"
+        },
+        .layout = gpuScene->pipelineLayout
+    };
+
+    const VkResult result = vkCreateComputePipelines(context->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, pipeline);
+    vkDestroyShaderModule(context->device, module, nullptr);
+    if (result != VK_SUCCESS) {
+        SDL_Log("Create Compute Pipeline Failed: %s", path);
+        return false;
+    }
+    return true;
+}
+
+bool CreateGpuDrawPipeline(GpuScene* gpuScene, VulkanContext* context) {
+    // A frame in flight may still be drawing with the old pipeline
+    if (gpuScene->drawPipeline != VK_NULL_HANDLE) {
+        DeferDestroy(context, VK_OBJECT_TYPE_PIPELINE, (uint64_t) gpuScene->drawPipeline);
+        gpuScene->drawPipeline = VK_NULL_HANDLE;
+    }
+
+    VkShaderModule vertModule = LoadShaderModule(&context->device, "shaders/vert.spv");
+    VkShaderModule fragModule = LoadShaderModule(&context->device, "shaders/frag.spv");
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = vertModule,
+            .pName = "main"
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = fragModule,
+            .pName = "main"
+        }
+    };
+
+    VkDynamicState dynamicStates[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = 2,
+        .pDynamicStates = dynamicStates
+    };
+
+    VkVertexInputBindingDescription vertexBinding = {
+        .binding = 0,
+        .stride = sizeof(MeshVertex),
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+    };
+    VkVertexInputAttributeDescription vertexAttributes[2] = {
+        {.location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(MeshVertex, position)},
+        {.location = 1, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(MeshVertex, normal)}
+    };
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &vertexBinding,
+        .vertexAttributeDescriptionCount = 2,
+        .pVertexAttributeDescriptions = vertexAttributes,
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = false
+    };
+
+    VkPipelineViewportStateCreateInfo viewportState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = false,
+        .rasterizerDiscardEnable = false,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_BACK_BIT,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .depthBiasEnable = false,
+        .lineWidth = 1.0f
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .sampleShadingEnable = false,
+        .minSampleShading = 1.0f
+    };
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = true,
+        .depthWriteEnable = true,
+        .depthCompareOp = VK_COMPARE_OP_LESS,
+        .depthBoundsTestEnable = false,
+        .stencilTestEnable = false
+    };
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {
+        .blendEnable = false,
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+    };
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = false,
+        .logicOp = VK_LOGIC_OP_COPY,
+        .attachmentCount = 1,
+        .pAttachments = &colorBlendAttachment
+    };
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = 2,
+        .pStages = shaderStages,
+        .pVertexInputState = &vertexInputInfo,
+        .pInputAssemblyState = &inputAssembly,
+        .pViewportState = &viewportState,
+        .pRasterizationState = &rasterizer,
+        .pMultisampleState = &multisampling,
+        .pDepthStencilState = &depthStencil,
+        .pColorBlendState = &colorBlending,
+        .pDynamicState = &dynamicState,
+        .layout = gpuScene->pipelineLayout,
+        .renderPass = context->renderPass,
+        .subpass = 0
+    };
+
+    const VkResult result = vkCreateGraphicsPipelines(context->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &gpuScene->drawPipeline);
+    vkDestroyShaderModule(context->device, vertModule, nullptr);
+    vkDestroyShaderModule(context->device, fragModule, nullptr);
+    if (result != VK_SUCCESS) {
+        SDL_Log("Create Graphics Pipeline Failed");
+        return false;
+    }
+    return true;
+}
+
+bool CreateGpuScene(GpuScene* gpuScene, VulkanContext* context, uint32_t maxInstances) {
+    gpuScene->maxInstances = maxInstances;
+    gpuScene->instanceCount = 0;
+    gpuScene->meshCount = 0;
+    gpuScene->drawPipeline = VK_NULL_HANDLE;
+    gpuScene->perBucketDraws = !context->supportsDrawIndirectCount || !context->supportsDrawIndirectFirstInstance;
+
+    const uint32_t sphereSegments[GPU_MAX_LODS] = {48, 24, 12, 6};
+    const float sphereDistances[GPU_MAX_LODS] = {40.0f, 120.0f, 300.0f, 1e30f};
+    BuildSphereMesh(gpuScene, sphereSegments, sphereDistances, GPU_MAX_LODS);
+
+    const VkMemoryPropertyFlags deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    const VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    const VkDeviceSize vertexBytes = sizeof(MeshVertex) * gpuScene->vertices.size();
+    const VkDeviceSize indexBytes = sizeof(uint32_t) * gpuScene->indices.size();
+    if (!CreateBuffer(context, vertexBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, deviceLocal,
+                      &gpuScene->vertexBuffer, &gpuScene->vertexMemory)
+        || !CreateBuffer(context, indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, deviceLocal,
+                         &gpuScene->indexBuffer, &gpuScene->indexMemory)
+        || !CreateBuffer(context, sizeof(gpuScene->meshes), storage, deviceLocal, &gpuScene->meshBuffer, &gpuScene->meshMemory)
+        || !CreateBuffer(context, sizeof(uint32_t) * GPU_MAX_BUCKETS, storage, deviceLocal,
+                         &gpuScene->bucketCountBuffer, &gpuScene->bucketCountMemory)
+        || !CreateBuffer(context, sizeof(uint32_t) * maxInstances * GPU_MAX_LODS, storage, deviceLocal,
+                         &gpuScene->visibleBuffer, &gpuScene->visibleMemory)
+        || !CreateBuffer(context, sizeof(VkDrawIndexedIndirectCommand) * GPU_MAX_BUCKETS, storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                         deviceLocal, &gpuScene->drawCommandBuffer, &gpuScene->drawCommandMemory)
+        || !CreateBuffer(context, sizeof(uint32_t), storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, deviceLocal,
+                         &gpuScene->drawCountBuffer, &gpuScene->drawCountMemory)) {
+        return false;
+    }
+
+    if (!UploadToBuffer(context, gpuScene->vertexBuffer, gpuScene->vertices.data(), vertexBytes)
+        || !UploadToBuffer(context, gpuScene->indexBuffer, gpuScene->indices.data(), indexBytes)
+        || !UploadToBuffer(context, gpuScene->meshBuffer, gpuScene->meshes, sizeof(gpuScene->meshes))) {
+        return false;
+    }
+
+    // 256 covers every implementation's minStorageBufferOffsetAlignment
+    gpuScene->modelsOffset = AlignUp(sizeof(GpuFrameData), 256);
+    gpuScene->meshIdsOffset = AlignUp(gpuScene->modelsOffset + sizeof(Mat4) * maxInstances, 256);
+    const VkDeviceSize frameBytes = gpuScene->meshIdsOffset + sizeof(uint32_t) * maxInstances;
+
+    for (GpuFrameSlot& slot : gpuScene->frames) {
+        if (!CreateBuffer(context, frameBytes, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &slot.buffer, &slot.memory)) {
+            return false;
+        }
+        if (vkMapMemory(context->device, slot.memory, 0, frameBytes, 0, (void**) &slot.mapped) != VK_SUCCESS) {
+            SDL_Log("Map Frame Buffer Failed");
+            slot.mapped = nullptr;
+            return false;
+        }
+    }
+
+    if (!CreateDescriptors(gpuScene, context)
+        || !CreateComputePipeline(gpuScene, context, "shaders/cull.spv", &gpuScene->cullPipeline)
+        || !CreateComputePipeline(gpuScene, context, "shaders/compact.spv", &gpuScene->compactPipeline)
+        || !CreateGpuDrawPipeline(gpuScene, context)) {
+        return false;
+    }
+
+    SDL_Log("GPU scene: %u instances max, %zu vertices, %zu indices, %s",
+            maxInstances, gpuScene->vertices.size(), gpuScene->indices.size(),
+            gpuScene->perBucketDraws ? "one indirect draw per bucket" : "indirect count draws");
+    return true;
+}
+
+void DestroyGpuScene(GpuScene* gpuScene, VulkanContext* context) {
+    VkDevice device = context->device;
+
+    vkDestroyPipeline(device, gpuScene->drawPipeline, nullptr);
+    vkDestroyPipeline(device, gpuScene->compactPipeline, nullptr);
+    vkDestroyPipeline(device, gpuScene->cullPipeline, nullptr);
+    vkDestroyPipelineLayout(device, gpuScene->pipelineLayout, nullptr);
+    vkDestroyDescriptorPool(device, gpuScene->descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, gpuScene->setLayout, nullptr);
+
+    for (GpuFrameSlot& slot : gpuScene->frames) {
+        vkUnmapMemory(device, slot.memory);
+        DestroyBuffer(context, slot.buffer, slot.memory);
+    }
+
+    DestroyBuffer(context, gpuScene->drawCountBuffer, gpuScene->drawCountMemory);
+    DestroyBuffer(context, gpuScene->drawCommandBuffer, gpuScene->drawCommandMemory);
+    DestroyBuffer(context, gpuScene->visibleBuffer, gpuScene->visibleMemory);
+    DestroyBuffer(context, gpuScene->bucketCountBuffer, gpuScene->bucketCountMemory);
+    DestroyBuffer(context, gpuScene->meshBuffer, gpuScene->meshMemory);
+    DestroyBuffer(context, gpuScene->indexBuffer, gpuScene->indexMemory);
+    DestroyBuffer(context, gpuScene->vertexBuffer, gpuScene->vertexMemory);
+}
+
+static TransformStreams OffsetStreams(const TransformStreams& t, uint32_t offset) {
+    return {t.px + offset, t.py + offset, t.pz + offset, t.qx + offset, t.qy + offset, t.qz + offset, t.qw + offset, t.scale + offset};
+}
+
+bool UpdateGpuInstances(GpuScene* gpuScene, const SimSnapshot* snapshot, float alpha, const Camera& camera, float aspect,
+                        uint32_t frameSlot, JobSystem& jobs, LinearArena* frameArena) {
+    GpuFrameSlot& slot = gpuScene->frames[frameSlot];
+    Mat4* models = (Mat4*) (slot.mapped + gpuScene->modelsOffset);
+    uint32_t* meshIds = (uint32_t*) (slot.mapped + gpuScene->meshIdsOffset);
+
+    uint32_t instanceCount = snapshot->instanceCount;
+    if (instanceCount > gpuScene->maxInstances) {
+        instanceCount = gpuScene->maxInstances;
+    }
+    gpuScene->instanceCount = instanceCount;
+
+    const uint32_t threadCount = jobs.ThreadCount();
+    // One cache line of counters per thread
+    uint32_t* threadMeshCounts = (uint32_t*) ArenaAlloc(frameArena, sizeof(uint32_t) * threadCount * GPU_MAX_MESHES, 64);
+    if (!threadMeshCounts) {
+        return false;
+    }
+    memset(threadMeshCounts, 0, sizeof(uint32_t) * threadCount * GPU_MAX_MESHES);
+
+    const TransformStreams previous = snapshot->Previous();
+    const TransformStreams current = snapshot->Current();
+    const uint32_t lastMesh = gpuScene->meshCount - 1;
+    jobs.ParallelFor(instanceCount, GPU_INSTANCE_BATCH, [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+        ComposeInterpolatedWorldMatrices(OffsetStreams(previous, begin), OffsetStreams(current, begin), alpha,
+                                         end - begin, models + begin);
+
+        uint32_t* meshCounts = &threadMeshCounts[threadIndex * GPU_MAX_MESHES];
+        for (uint32_t i = begin; i < end; i++) {
+            const uint32_t mesh = snapshot->meshIds[i] < lastMesh ? snapshot->meshIds[i] : lastMesh;
+            meshIds[i] = mesh;
+            meshCounts[mesh]++;
+        }
+    });
+
+    GpuFrameData* frame = (GpuFrameData*) slot.mapped;
+    const Mat4 projection = Mat4Perspective(camera.fovY, aspect, camera.nearPlane, camera.farPlane);
+    const Mat4 view = Mat4LookAt(camera.position, camera.target, {0.0f, 1.0f, 0.0f});
+    frame->viewProjection = Mat4Mul(projection, view);
+
+    const Frustum frustum = FrustumFromViewProjection(frame->viewProjection);
+    for (int i = 0; i < 6; i++) {
+        frame->frustumPlanes[i] = frustum.planes[i];
+    }
+    frame->cameraPosition = {camera.position.x, camera.position.y, camera.position.z, 1.0f};
+    frame->instanceCount = instanceCount;
+    frame->bucketCount = gpuScene->meshCount * GPU_MAX_LODS;
+    frame->perBucketDraws = gpuScene->perBucketDraws ? 1 : 0;
+
+    // Every LOD bucket of a mesh can hold all of that mesh's instances
+    uint32_t bucketBase = 0;
+    for (uint32_t mesh = 0; mesh < gpuScene->meshCount; mesh++) {
+        uint32_t meshInstances = 0;
+        for (uint32_t t = 0; t < threadCount; t++) {
+            meshInstances += threadMeshCounts[t * GPU_MAX_MESHES + mesh];
+        }
+        for (uint32_t lod = 0; lod < GPU_MAX_LODS; lod++) {
+            frame->bucketBase[mesh * GPU_MAX_LODS + lod] = bucketBase;
+            slot.bucketBase[mesh * GPU_MAX_LODS + lod] = bucketBase;
+            bucketBase += meshInstances;
+        }
+    }
+    return true;
+}
+
+static void ComputeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                           VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = dstAccess
+    };
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void RecordGpuCulling(GpuScene* gpuScene, VkCommandBuffer commandBuffer, uint32_t frameSlot) {
+    // The previous frame's draw still reads the shared buffers we are about to clear
+    ComputeBarrier(commandBuffer,
+                   VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    vkCmdFillBuffer(commandBuffer, gpuScene->bucketCountBuffer, 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(commandBuffer, gpuScene->drawCommandBuffer, 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(commandBuffer, gpuScene->drawCountBuffer, 0, VK_WHOLE_SIZE, 0);
+
+    ComputeBarrier(commandBuffer,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, gpuScene->pipelineLayout, 0, 1,
+                            &gpuScene->frames[frameSlot].descriptorSet, 0, nullptr);
+
+    if (gpuScene->instanceCount > 0) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, gpuScene->cullPipeline);
+        vkCmdDispatch(commandBuffer, (gpuScene->instanceCount + GPU_CULL_GROUP_SIZE - 1) / GPU_CULL_GROUP_SIZE, 1, 1);
+    }
+
+    ComputeBarrier(commandBuffer,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    // One invocation per bucket, GPU_MAX_BUCKETS fits a single workgroup
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, gpuScene->compactPipeline);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+    ComputeBarrier(commandBuffer,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                   VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+}
+
+void RecordGpuDraw(GpuScene* gpuScene, const VulkanContext* context, VkCommandBuffer commandBuffer, uint32_t frameSlot) {
+    VkViewport viewport = {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = (float) context->extent.width,
+        .height = (float) context->extent.height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f
+    };
+    VkRect2D scissor = {
+        .offset = {0, 0},
+        .extent = context->extent
+    };
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, gpuScene->drawPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, gpuScene->pipelineLayout, 0, 1,
+                            &gpuScene->frames[frameSlot].descriptorSet, 0, nullptr);
+
+    const VkDeviceSize vertexOffset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &gpuScene->vertexBuffer, &vertexOffset);
+    vkCmdBindIndexBuffer(commandBuffer, gpuScene->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+    const uint32_t bucketCount = gpuScene->meshCount * GPU_MAX_LODS;
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (!gpuScene->perBucketDraws) {
+        const uint32_t instanceBase = 0; // firstInstance carries the bucket base
+        vkCmdPushConstants(commandBuffer, gpuScene->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &instanceBase);
+        vkCmdDrawIndexedIndirectCount(commandBuffer, gpuScene->drawCommandBuffer, 0, gpuScene->drawCountBuffer, 0, bucketCount, stride);
+    }
+    else {
+        // Every bucket's slot is rewritten each frame, empty buckets with instanceCount 0
+        const GpuFrameSlot& slot = gpuScene->frames[frameSlot];
+        for (uint32_t i = 0; i < bucketCount; i++) {
+            vkCmdPushConstants(commandBuffer, gpuScene->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t),
+                               &slot.bucketBase[i]);
+            vkCmdDrawIndexedIndirect(commandBuffer, gpuScene->drawCommandBuffer, i * stride, 1, stride);
+        }
+    }
+}
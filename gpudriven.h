@@ -0,0 +1,127 @@
+#ifndef GPUDRIVEN_H
+#define GPUDRIVEN_H
+
+#include <cstdint>
+#include <vector>
+#include "jobs.h"
+#include "mathlib.h"
+#include "memory.h"
+#include "simulation.h"
+#include "vulkancontext.h"
+
+// GPU driven scene rendering.
+//
+// Each frame the CPU only writes per-instance world matrices, blended from the
+// latest simulation snapshot, and mesh ids into a
+// host visible storage buffer. A compute pass frustum culls every instance,
+// picks a LOD by distance and appends the instance id to a bucket per (mesh, LOD).
+// A second pass compacts the non-empty buckets into VkDrawIndexedIndirectCommands
+// and the whole scene is drawn with one vkCmdDrawIndexedIndirectCount.
+
+constexpr uint32_t GPU_MAX_MESHES = 16;
+constexpr uint32_t GPU_MAX_LODS = 4;
+constexpr uint32_t GPU_MAX_BUCKETS = GPU_MAX_MESHES * GPU_MAX_LODS;
+constexpr uint32_t GPU_CULL_GROUP_SIZE = 64;
+constexpr uint32_t GPU_INSTANCE_BATCH = 4096; // instances per job when writing the instance buffer
+
+// Layouts below mirror the std140/std430 declarations in shaders/*.comp and shader.vert
+
+struct MeshVertex {
+    float position[3];
+    float normal[3];
+};
+
+struct GpuMeshLod {
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    float maxDistance;
+};
+
+struct GpuMeshInfo {
+    Vec4 boundingSphere;
+    GpuMeshLod lods[GPU_MAX_LODS];
+    uint32_t lodCount;
+    uint32_t padding[3];
+};
+
+struct GpuFrameData {
+    Mat4 viewProjection;
+    Vec4 frustumPlanes[6];
+    Vec4 cameraPosition;
+    uint32_t instanceCount;
+    uint32_t bucketCount;
+    uint32_t perBucketDraws; // see GpuScene::perBucketDraws
+    uint32_t padding;
+    uint32_t bucketBase[GPU_MAX_BUCKETS]; // packed as uvec4[GPU_MAX_BUCKETS / 4]
+};
+
+struct GpuFrameSlot {
+    VkBuffer buffer;           // frame data, world matrices and mesh ids, persistently mapped
+    VkDeviceMemory memory;
+    uint8_t* mapped;
+    VkDescriptorSet descriptorSet;
+    uint32_t bucketBase[GPU_MAX_BUCKETS]; // CPU copy for the per-bucket draw path
+};
+
+struct GpuScene {
+    uint32_t maxInstances;
+    uint32_t instanceCount;
+    uint32_t meshCount;
+    // Without drawIndirectCount or drawIndirectFirstInstance every bucket keeps its
+    // own command slot with firstInstance 0 and is drawn on its own, the bucket's
+    // base into the visible ids comes from a push constant instead
+    bool perBucketDraws;
+
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    GpuMeshInfo meshes[GPU_MAX_MESHES];
+
+    VkBuffer vertexBuffer;
+    VkDeviceMemory vertexMemory;
+    VkBuffer indexBuffer;
+    VkDeviceMemory indexMemory;
+    VkBuffer meshBuffer;
+    VkDeviceMemory meshMemory;
+
+    // GPU written, shared by all frame slots since the queue serialises them
+    VkBuffer bucketCountBuffer;
+    VkDeviceMemory bucketCountMemory;
+    VkBuffer visibleBuffer;
+    VkDeviceMemory visibleMemory;
+    VkBuffer drawCommandBuffer;
+    VkDeviceMemory drawCommandMemory;
+    VkBuffer drawCountBuffer;
+    VkDeviceMemory drawCountMemory;
+
+    VkDeviceSize modelsOffset;
+    VkDeviceSize meshIdsOffset;
+    GpuFrameSlot frames[MAX_FRAMES_IN_FLIGHT];
+
+    VkDescriptorSetLayout setLayout;
+    VkDescriptorPool descriptorPool;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline cullPipeline;
+    VkPipeline compactPipeline;
+    VkPipeline drawPipeline;
+};
+
+bool CreateGpuScene(GpuScene* gpuScene, VulkanContext* context, uint32_t maxInstances);
+void DestroyGpuScene(GpuScene* gpuScene, VulkanContext* context);
+
+// The graphics pipeline depends on the render pass, so it is rebuilt with the swapchain.
+// The previous pipeline is handed to DeferDestroy.
+bool CreateGpuDrawPipeline(GpuScene* gpuScene, VulkanContext* context);
+
+// Writes the camera and every snapshot instance, blended by alpha, into the frame
+// slot's mapped buffer. Per frame bookkeeping comes from frameArena, returns false
+// when it is exhausted.
+bool UpdateGpuInstances(GpuScene* gpuScene, const SimSnapshot* snapshot, float alpha, const Camera& camera, float aspect,
+                        uint32_t frameSlot, JobSystem& jobs, LinearArena* frameArena);
+
+// Culling and compaction, recorded outside the render pass
+void RecordGpuCulling(GpuScene* gpuScene, VkCommandBuffer commandBuffer, uint32_t frameSlot);
+// Indirect draw of everything that survived culling, recorded inside the render pass
+void RecordGpuDraw(GpuScene* gpuScene, const VulkanContext* context, VkCommandBuffer commandBuffer, uint32_t frameSlot);
+
+#endif //GPUDRIVEN_H
@@ -0,0 +1,238 @@
+#include "gpumemory.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include "SDL3/SDL_log.h"
+#include "memory.h"
+
+constexpr double MIB = 1024.0 * 1024.0;
+
+bool SupportsMemoryBudget(VkPhysicalDevice physicalDevice, uint32_t apiVersion) {
+    if (apiVersion < VK_API_VERSION_1_1) {
+        return false; // vkGetPhysicalDeviceMemoryProperties2 is core from 1.1
+    }
+
+    ScratchScope scratch(ScratchArena());
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    VkExtensionProperties* extensions = scratch.AllocArray<VkExtensionProperties>(extensionCount);
+    if (!extensions) {
+        return false;
+    }
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions);
+
+    for (uint32_t i = 0; i < extensionCount; i++) {
+        if (strcmp(extensions[i].extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void InitGpuMemoryTracker(GpuMemoryTracker* tracker, VkPhysicalDevice physicalDevice, bool budgetEnabled) {
+    tracker->physicalDevice = physicalDevice;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &tracker->memoryProperties);
+    tracker->budgetEnabled = budgetEnabled;
+    tracker->warningRatio = 0.8f;
+    tracker->criticalRatio = 0.95f;
+    tracker->reportInterval = 600;
+    tracker->jsonPath = nullptr;
+    tracker->allocations.reserve(64);
+
+    memset(&tracker->stats, 0, sizeof(GpuMemoryStats));
+    tracker->stats.heapCount = tracker->memoryProperties.memoryHeapCount;
+    for (uint32_t i = 0; i < tracker->stats.heapCount; i++) {
+        const VkMemoryHeap& heap = tracker->memoryProperties.memoryHeaps[i];
+        tracker->stats.heaps[i].size = heap.size;
+        tracker->stats.heaps[i].budget = heap.size;
+        tracker->stats.heaps[i].deviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+
+    SDL_Log("GPU memory: %u heaps, VK_EXT_memory_budget %s", tracker->stats.heapCount,
+            budgetEnabled ? "enabled" : "unavailable, using engine totals");
+}
+
+VkResult TrackedAllocateMemory(GpuMemoryTracker* tracker, VkDevice device, const VkMemoryAllocateInfo* allocateInfo,
+                               GpuMemoryCategory category, VkDeviceMemory* memory) {
+    const VkResult result = vkAllocateMemory(device, allocateInfo, nullptr, memory);
+    if (result != VK_SUCCESS || !tracker) {
+        return result;
+    }
+
+    const uint32_t heapIndex = tracker->memoryProperties.memoryTypes[allocateInfo->memoryTypeIndex].heapIndex;
+    tracker->allocations.push_back({*memory, allocateInfo->allocationSize, heapIndex, category});
+    tracker->stats.heaps[heapIndex].engineBytes += allocateInfo->allocationSize;
+    tracker->stats.categoryBytes[(uint32_t) category] += allocateInfo->allocationSize;
+    tracker->stats.categoryAllocations[(uint32_t) category]++;
+    return result;
+}
+
+void TrackedFreeMemory(GpuMemoryTracker* tracker, VkDevice device, VkDeviceMemory memory) {
+    vkFreeMemory(device, memory, nullptr);
+    if (!tracker || memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    for (size_t i = 0; i < tracker->allocations.size(); i++) {
+        const GpuMemoryTracker::Allocation allocation = tracker->allocations[i];
+        if (allocation.memory == memory) {
+            tracker->stats.heaps[allocation.heapIndex].engineBytes -= allocation.size;
+            tracker->stats.categoryBytes[(uint32_t) allocation.category] -= allocation.size;
+            tracker->stats.categoryAllocations[(uint32_t) allocation.category]--;
+            tracker->allocations[i] = tracker->allocations.back();
+            tracker->allocations.pop_back();
+            return;
+        }
+    }
+    SDL_Log("Freed untracked device memory");
+}
+
+void AddGpuMemoryPressureCallback(GpuMemoryTracker* tracker, GpuMemoryPressureCallback callback, void* userData) {
+    tracker->listeners.push_back({callback, userData});
+}
+
+static GpuMemoryPressure PressureOf(const GpuMemoryTracker* tracker, const GpuHeapStats& heap) {
+    if (heap.budget == 0) {
+        return GpuMemoryPressure::Normal;
+    }
+    const double ratio = (double) heap.usage / (double) heap.budget;
+    if (ratio >= tracker->criticalRatio) {
+        return GpuMemoryPressure::Critical;
+    }
+    if (ratio >= tracker->warningRatio) {
+        return GpuMemoryPressure::Warning;
+    }
+    return GpuMemoryPressure::Normal;
+}
+
+void UpdateGpuMemoryBudget(GpuMemoryTracker* tracker) {
+    GpuMemoryStats& stats = tracker->stats;
+    stats.frame++;
+    stats.budgetAvailable = tracker->budgetEnabled;
+
+    if (tracker->budgetEnabled) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT
+        };
+        VkPhysicalDeviceMemoryProperties2 properties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+            .pNext = &budget
+        };
+        vkGetPhysicalDeviceMemoryProperties2(tracker->physicalDevice, &properties);
+        for (uint32_t i = 0; i < stats.heapCount; i++) {
+            stats.heaps[i].budget = budget.heapBudget[i];
+            stats.heaps[i].usage = budget.heapUsage[i];
+        }
+    }
+    else {
+        for (uint32_t i = 0; i < stats.heapCount; i++) {
+            stats.heaps[i].usage = stats.heaps[i].engineBytes;
+        }
+    }
+
+    // Callbacks fire on level changes only, so a heap sitting at Warning is not re-reported every frame
+    for (uint32_t i = 0; i < stats.heapCount; i++) {
+        const GpuMemoryPressure pressure = PressureOf(tracker, stats.heaps[i]);
+        if (pressure == stats.heaps[i].pressure) {
+            continue;
+        }
+
+        stats.heaps[i].pressure = pressure;
+        if (pressure != GpuMemoryPressure::Normal) {
+            SDL_Log("GPU heap %u at %s pressure: %.1f of %.1f MiB", i,
+                    pressure == GpuMemoryPressure::Critical ? "critical" : "warning",
+                    (double) stats.heaps[i].usage / MIB, (double) stats.heaps[i].budget / MIB);
+        }
+        for (const GpuMemoryTracker::Listener& listener : tracker->listeners) {
+            listener.callback(pressure, i, stats, listener.userData);
+        }
+    }
+
+    if (tracker->reportInterval > 0 && stats.frame % tracker->reportInterval == 0) {
+        LogGpuMemoryStats(stats);
+        // A report that comes due while the previous one is still being written is skipped
+        if (tracker->jsonPath && !tracker->jsonWriter.Busy()) {
+            const size_t length = FormatGpuMemoryStatsJson(stats, tracker->json, sizeof(tracker->json));
+            if (length > 0) {
+                tracker->jsonWriter.Submit(tracker->jsonPath, tracker->json, length);
+            }
+        }
+    }
+}
+
+const GpuMemoryStats& GetGpuMemoryStats(const GpuMemoryTracker* tracker) {
+    return tracker->stats;
+}
+
+const char* GpuMemoryCategoryName(GpuMemoryCategory category) {
+    switch (category) {
+        case GpuMemoryCategory::Buffer: return "buffers";
+        case GpuMemoryCategory::Texture: return "textures";
+        case GpuMemoryCategory::Attachment: return "attachments";
+        case GpuMemoryCategory::Staging: return "staging";
+        default: return "unknown";
+    }
+}
+
+static const char* PressureName(GpuMemoryPressure pressure) {
+    switch (pressure) {
+        case GpuMemoryPressure::Warning: return "warning";
+        case GpuMemoryPressure::Critical: return "critical";
+        default: return "normal";
+    }
+}
+
+void LogGpuMemoryStats(const GpuMemoryStats& stats) {
+    SDL_Log("GPU memory at frame %llu%s:", (unsigned long long) stats.frame,
+            stats.budgetAvailable ? "" : " (no budget extension)");
+    for (uint32_t i = 0; i < stats.heapCount; i++) {
+        const GpuHeapStats& heap = stats.heaps[i];
+        SDL_Log("  heap %u%s: usage %.1f / budget %.1f MiB (engine %.1f, size %.1f MiB) %s", i,
+                heap.deviceLocal ? " device local" : "",
+                (double) heap.usage / MIB, (double) heap.budget / MIB,
+                (double) heap.engineBytes / MIB, (double) heap.size / MIB, PressureName(heap.pressure));
+    }
+    for (uint32_t c = 0; c < GPU_MEMORY_CATEGORY_COUNT; c++) {
+        SDL_Log("  %-12s %8.1f MiB in %u allocations", GpuMemoryCategoryName((GpuMemoryCategory) c),
+                (double) stats.categoryBytes[c] / MIB, stats.categoryAllocations[c]);
+    }
+}
+
+// snprintf at the end of buffer, length goes past capacity once the output no longer fits
+static void AppendJson(char* buffer, size_t capacity, size_t& length, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    const int written = length < capacity ? vsnprintf(buffer + length, capacity - length, format, args) : 0;
+    va_end(args);
+    length += written > 0 ? (size_t) written : capacity;
+}
+
+size_t FormatGpuMemoryStatsJson(const GpuMemoryStats& stats, char* buffer, size_t capacity) {
+    size_t length = 0;
+    AppendJson(buffer, capacity, length, "{\n  \"frame\": %llu,\n  \"budgetAvailable\": %s,\n  \"heaps\": [\n",
+               (unsigned long long) stats.frame, stats.budgetAvailable ? "true" : "false");
+    for (uint32_t i = 0; i < stats.heapCount; i++) {
+        const GpuHeapStats& heap = stats.heaps[i];
+        AppendJson(buffer, capacity, length,
+                   "    {\"index\": %u, \"deviceLocal\": %s, \"size\": %llu, \"budget\": %llu, \"usage\": %llu, "
+                   "\"engineBytes\": %llu, \"pressure\": \"%s\"}%s\n",
+                   i, heap.deviceLocal ? "true" : "false",
+                   (unsigned long long) heap.size, (unsigned long long) heap.budget, (unsigned long long) heap.usage,
+                   (unsigned long long) heap.engineBytes, PressureName(heap.pressure),
+                   i + 1 < stats.heapCount ? "," : "");
+    }
+    AppendJson(buffer, capacity, length, "  ],\n  \"categories\": {\n");
+    for (uint32_t c = 0; c < GPU_MEMORY_CATEGORY_COUNT; c++) {
+        AppendJson(buffer, capacity, length, "    \"%s\": {\"bytes\": %llu, \"allocations\": %u}%s\n",
+                   GpuMemoryCategoryName((GpuMemoryCategory) c),
+                   (unsigned long long) stats.categoryBytes[c], stats.categoryAllocations[c],
+                   c + 1 < GPU_MEMORY_CATEGORY_COUNT ? "," : "");
+    }
+    AppendJson(buffer, capacity, length, "  }\n}\n");
+
+    if (length >= capacity) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "GPU memory stats do not fit in %zu bytes", capacity);
+        return 0;
+    }
+    return length;
+}
@@ -0,0 +1,109 @@
+#ifndef GPUMEMORY_H
+#define GPUMEMORY_H
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "filewriter.h"
+
+// GPU memory telemetry.
+//
+// Every device allocation made through TrackedAllocateMemory is attributed to a
+// category and a heap. Once per frame UpdateGpuMemoryBudget reads the driver's
+// per-heap usage and budget through VK_EXT_memory_budget (or falls back to the
+// engine's own totals against the heap size), raises pressure callbacks when a
+// heap crosses a threshold and periodically logs the numbers or dumps them as JSON.
+// The JSON is formatted into a fixed buffer on the frame and written to disk by a
+// FileWriter thread.
+
+enum class GpuMemoryCategory : uint32_t {
+    Buffer,
+    Texture,
+    Attachment,
+    Staging,
+    Count
+};
+
+constexpr uint32_t GPU_MEMORY_CATEGORY_COUNT = (uint32_t) GpuMemoryCategory::Count;
+constexpr uint32_t GPU_MEMORY_JSON_CAPACITY = 8 * 1024; // fits VK_MAX_MEMORY_HEAPS heaps
+
+enum class GpuMemoryPressure : uint32_t {
+    Normal,
+    Warning,  // usage above warningRatio of the budget, start shedding optional data
+    Critical  // usage above criticalRatio, the driver is about to page
+};
+
+struct GpuHeapStats {
+    VkDeviceSize size;
+    VkDeviceSize budget;      // how much this process can use before the OS starts evicting
+    VkDeviceSize usage;       // this process' usage as seen by the driver
+    VkDeviceSize engineBytes; // allocated through the tracker
+    bool deviceLocal;
+    GpuMemoryPressure pressure;
+};
+
+struct GpuMemoryStats {
+    uint64_t frame;
+    bool budgetAvailable; // false means budget == heap size and usage == engineBytes
+    uint32_t heapCount;
+    GpuHeapStats heaps[VK_MAX_MEMORY_HEAPS];
+    VkDeviceSize categoryBytes[GPU_MEMORY_CATEGORY_COUNT];
+    uint32_t categoryAllocations[GPU_MEMORY_CATEGORY_COUNT];
+};
+
+// Called from UpdateGpuMemoryBudget whenever a heap's pressure level changes, in either direction
+typedef void (*GpuMemoryPressureCallback)(GpuMemoryPressure pressure, uint32_t heapIndex,
+                                          const GpuMemoryStats& stats, void* userData);
+
+struct GpuMemoryTracker {
+    VkPhysicalDevice physicalDevice;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    bool budgetEnabled;
+    float warningRatio;
+    float criticalRatio;
+    uint32_t reportInterval; // frames between log/JSON reports, 0 disables them
+    const char* jsonPath;    // nullptr to only log
+
+    struct Allocation {
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+        uint32_t heapIndex;
+        GpuMemoryCategory category;
+    };
+    std::vector<Allocation> allocations;
+
+    struct Listener {
+        GpuMemoryPressureCallback callback;
+        void* userData;
+    };
+    std::vector<Listener> listeners;
+
+    GpuMemoryStats stats;
+
+    FileWriter jsonWriter;
+    char json[GPU_MEMORY_JSON_CAPACITY]; // owned by jsonWriter while it is busy
+};
+
+// True when the device exposes VK_EXT_memory_budget and the API version can query it
+bool SupportsMemoryBudget(VkPhysicalDevice physicalDevice, uint32_t apiVersion);
+
+// budgetEnabled must only be set when VK_EXT_memory_budget was enabled on the device
+void InitGpuMemoryTracker(GpuMemoryTracker* tracker, VkPhysicalDevice physicalDevice, bool budgetEnabled);
+
+// vkAllocateMemory / vkFreeMemory with attribution. tracker may be null.
+VkResult TrackedAllocateMemory(GpuMemoryTracker* tracker, VkDevice device, const VkMemoryAllocateInfo* allocateInfo,
+                               GpuMemoryCategory category, VkDeviceMemory* memory);
+void TrackedFreeMemory(GpuMemoryTracker* tracker, VkDevice device, VkDeviceMemory memory);
+
+void AddGpuMemoryPressureCallback(GpuMemoryTracker* tracker, GpuMemoryPressureCallback callback, void* userData);
+
+// Once per frame: refresh budgets, fire pressure callbacks and report on the interval
+void UpdateGpuMemoryBudget(GpuMemoryTracker* tracker);
+const GpuMemoryStats& GetGpuMemoryStats(const GpuMemoryTracker* tracker);
+
+const char* GpuMemoryCategoryName(GpuMemoryCategory category);
+void LogGpuMemoryStats(const GpuMemoryStats& stats);
+// Returns the length written to buffer, 0 if it did not fit
+size_t FormatGpuMemoryStatsJson(const GpuMemoryStats& stats, char* buffer, size_t capacity);
+
+#endif //GPUMEMORY_H
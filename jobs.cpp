@@ -0,0 +1,91 @@
+#include "jobs.h"
+
+JobSystem::JobSystem(uint32_t workerCount) {
+    if (workerCount == UINT32_MAX) {
+        const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::Run(uint32_t count, uint32_t grain, RangeFn fn, void* ctx) {
+    if (count == 0) return;
+    if (grain == 0) grain = 1;
+
+    // Not worth waking anyone for a single batch
+    if (workers.empty() || count <= grain) {
+        fn(ctx, 0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobFn = fn;
+        jobCtx = ctx;
+        jobCount = count;
+        jobGrain = grain;
+        nextIndex.store(0, std::memory_order_relaxed);
+        busyWorkers = (uint32_t) workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    Drain(0);
+
+    // Every worker has to acknowledge this generation before the job state can be reused
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busyWorkers == 0; });
+}
+
+void JobSystem::Drain(uint32_t threadIndex) {
+    for (;;) {
+        const uint32_t begin = nextIndex.fetch_add(jobGrain, std::memory_order_relaxed);
+        if (begin >= jobCount) {
+            return;
+        }
+        const uint32_t end = begin + jobGrain < jobCount ? begin + jobGrain : jobCount;
+        jobFn(jobCtx, begin, end, threadIndex);
+    }
+}
+
+void JobSystem::WorkerLoop(uint32_t threadIndex) {
+    uint64_t seenGeneration = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || generation != seenGeneration; });
+            if (quit) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        Drain(threadIndex);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            last = --busyWorkers == 0;
+        }
+        if (last) {
+            done.notify_one();
+        }
+    }
+}
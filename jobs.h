@@ -0,0 +1,54 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool for data-parallel loops. The calling thread takes part
+// in every loop as thread index 0, workers are 1..ThreadCount()-1.
+class JobSystem {
+public:
+    explicit JobSystem(uint32_t workerCount = UINT32_MAX);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    uint32_t ThreadCount() const { return (uint32_t) workers.size() + 1; }
+
+    // Calls fn(begin, end, threadIndex) over [0, count) in batches of `grain`
+    // and returns once every batch has finished.
+    template<typename Fn>
+    void ParallelFor(uint32_t count, uint32_t grain, Fn&& fn) {
+        Run(count, grain, [](void* ctx, uint32_t begin, uint32_t end, uint32_t threadIndex) {
+            (*(Fn*) ctx)(begin, end, threadIndex);
+        }, (void*) &fn);
+    }
+
+private:
+    typedef void (*RangeFn)(void* ctx, uint32_t begin, uint32_t end, uint32_t threadIndex);
+
+    void Run(uint32_t count, uint32_t grain, RangeFn fn, void* ctx);
+    void Drain(uint32_t threadIndex);
+    void WorkerLoop(uint32_t threadIndex);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    RangeFn jobFn = nullptr;
+    void* jobCtx = nullptr;
+    uint32_t jobCount = 0;
+    uint32_t jobGrain = 1;
+    std::atomic<uint32_t> nextIndex{0};
+    uint32_t busyWorkers = 0;
+    uint64_t generation = 0;
+    bool quit = false;
+};
+
+#endif //JOBS_H
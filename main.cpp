@@ -3,16 +3,41 @@
 #include <SDL3/SDL_main.h>
 #include <iostream>
 #include <queue>
-#include "common.h"
+#include "framecapture.h"
+#include "gpudriven.h"
+#include "memory.h"
+#include "scene.h"
+#include "simulation.h"
 #include "utility.h"
+#include "vulkancontext.h"
 #include <vulkan/vulkan.h>
 #include "SDL3/SDL_vulkan.h"
 
+constexpr uint32_t SCENE_ENTITY_COUNT = 100000;
+constexpr size_t FRAME_ARENA_SIZE = 4 * 1024 * 1024;
+// Frames after startup before the loop is expected to stop touching the heap
+constexpr uint64_t WARMUP_FRAMES = 120;
+constexpr uint64_t HEAP_REPORT_INTERVAL = 600;
+// Each captured frame carries the full snapshot, about 6 MiB at SCENE_ENTITY_COUNT
+constexpr uint32_t CAPTURE_FRAME_COUNT = 8;
+
 typedef struct {
     SDL_Window *Window;
     SDL_Renderer *Renderer;
     SDL_GPUDevice *Device;
     SDL_GPUShaderFormat SupportedShaders;
+    Scene *ActiveScene;
+    Simulation *Sim;
+    JobSystem *RenderJobs; // the scene's job system belongs to the simulation thread
+    VulkanContext Vulkan;
+    GpuScene *Gpu;
+    bool SwapchainDirty;
+    LinearArena FrameArena; // reset at the start of every frame
+    uint64_t FrameNumber;
+    uint64_t SteadyStateAllocations; // heap allocations made by frames since the last report
+    FrameCapture *Capture;
+    const char *CapturePath;
+    bool CaptureOnStartup; // ENGINE_CAPTURE_PATH was set, capture once warmup is over
 } AppState;
 
 struct QueueFamilyIndices {
@@ -30,9 +55,8 @@ struct SwapchainSupportDetails {
     uint32_t presentModeCount = 0;
 };
 
-static SDL_Renderer *renderer = nullptr;
-
-SwapchainSupportDetails FindSwapChainDetails(const VkPhysicalDevice *device, const VkSurfaceKHR *surface) {
+// The format and present mode arrays are allocated from scratch, their counts stay 0 if scratch runs out
+SwapchainSupportDetails FindSwapChainDetails(const VkPhysicalDevice *device, const VkSurfaceKHR *surface, ScratchScope &scratch) {
     SwapchainSupportDetails details;
 
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(*device, *surface, &details.capabilities);
@@ -41,18 +65,22 @@ SwapchainSupportDetails FindSwapChainDetails(const VkPhysicalDevice *device, con
     vkGetPhysicalDeviceSurfaceFormatsKHR(*device, *surface, &formatCount, nullptr);
 
     if (formatCount != 0) {
-        details.formats = (VkSurfaceFormatKHR*) malloc(sizeof(VkSurfaceKHR) * formatCount);
-        details.formatCount = formatCount;
-        vkGetPhysicalDeviceSurfaceFormatsKHR(*device, *surface, &formatCount, details.formats);
+        details.formats = scratch.AllocArray<VkSurfaceFormatKHR>(formatCount);
+        if (details.formats) {
+            details.formatCount = formatCount;
+            vkGetPhysicalDeviceSurfaceFormatsKHR(*device, *surface, &details.formatCount, details.formats);
+        }
     }
 
     uint32_t presentModeCount;
     vkGetPhysicalDeviceSurfacePresentModesKHR(*device, *surface, &presentModeCount, nullptr);
 
     if (presentModeCount != 0) {
-        details.presentModes = (VkPresentModeKHR*) malloc(sizeof(VkPresentModeKHR) * presentModeCount);
-        details.presentModeCount = presentModeCount;
-        vkGetPhysicalDeviceSurfacePresentModesKHR(*device, *surface, &presentModeCount, details.presentModes);
+        details.presentModes = scratch.AllocArray<VkPresentModeKHR>(presentModeCount);
+        if (details.presentModes) {
+            details.presentModeCount = presentModeCount;
+            vkGetPhysicalDeviceSurfacePresentModesKHR(*device, *surface, &details.presentModeCount, details.presentModes);
+        }
     }
 
     return details;
@@ -67,7 +95,11 @@ QueueFamilyIndices FindQueueFamilies(const VkPhysicalDevice *device, const VkSur
     VkPhysicalDeviceProperties deviceProperties;
     vkGetPhysicalDeviceProperties(*device, &deviceProperties);
 
-    VkQueueFamilyProperties *queueFamilies = (VkQueueFamilyProperties *) malloc(sizeof(VkQueueFamilyProperties) * queueFamilyCount);
+    ScratchScope scratch(ScratchArena());
+    VkQueueFamilyProperties *queueFamilies = scratch.AllocArray<VkQueueFamilyProperties>(queueFamilyCount);
+    if (!queueFamilies) {
+        return indices;
+    }
     vkGetPhysicalDeviceQueueFamilyProperties(*device, &queueFamilyCount, queueFamilies);
 
     for (int i = 0; i < queueFamilyCount; i++) {
@@ -87,7 +119,6 @@ QueueFamilyIndices FindQueueFamilies(const VkPhysicalDevice *device, const VkSur
         }
     }
 
-    free(queueFamilies);
     return indices;
 }
 
@@ -105,7 +136,8 @@ VkPhysicalDevice ChoosePhysicalDevice(const VkPhysicalDevice *physicalDevices, c
 
         // need to check if device supports swapchain extension
 
-        const SwapchainSupportDetails swapChainSupport = FindSwapChainDetails(&device, surface);
+        ScratchScope scratch(ScratchArena());
+        const SwapchainSupportDetails swapChainSupport = FindSwapChainDetails(&device, surface, scratch);
         const bool swapChainAdequate = swapChainSupport.formats != nullptr && swapChainSupport.presentModes != nullptr;
 
         if (queueFamiliesComplete && swapChainAdequate) {
@@ -170,23 +202,324 @@ VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR* capabilities, SDL_Wi
     }
 }
 
-VkShaderModule CreateShaderModule(const VkDevice* device, const char* code, size_t codeLength) {
-    VkShaderModuleCreateInfo shaderModuleCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .codeSize = codeLength,
-        .pCode = (const uint32_t*)code
+// Immediate destruction, only valid once the device is idle
+void DestroySwapchain(VulkanContext* vk) {
+    for (uint32_t i = 0; i < vk->swapchainImageCount; i++) {
+        vkDestroyFramebuffer(vk->device, vk->framebuffers[i], nullptr);
+        vkDestroyImageView(vk->device, vk->swapchainImageViews[i], nullptr);
+        vkDestroySemaphore(vk->device, vk->renderFinished[i], nullptr);
+    }
+    vkDestroyImageView(vk->device, vk->depthImageView, nullptr);
+    vkDestroyImage(vk->device, vk->depthImage, nullptr);
+    TrackedFreeMemory(vk->memoryTracker, vk->device, vk->depthMemory);
+    vkDestroySwapchainKHR(vk->device, vk->swapchain, nullptr);
+}
+
+// Hands every swapchain dependent handle except the swapchain itself to the
+// deferred deletion queue, the old swapchain is still needed to create the new one
+void RetireSwapchainResources(VulkanContext* vk) {
+    for (uint32_t i = 0; i < vk->swapchainImageCount; i++) {
+        DeferDestroy(vk, VK_OBJECT_TYPE_FRAMEBUFFER, (uint64_t) vk->framebuffers[i]);
+        DeferDestroy(vk, VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t) vk->swapchainImageViews[i]);
+        DeferDestroy(vk, VK_OBJECT_TYPE_SEMAPHORE, (uint64_t) vk->renderFinished[i]);
+    }
+    DeferDestroy(vk, VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t) vk->depthImageView);
+    DeferDestroy(vk, VK_OBJECT_TYPE_IMAGE, (uint64_t) vk->depthImage);
+    DeferDestroy(vk, VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64_t) vk->depthMemory);
+}
+
+bool CreateDepthBuffer(VulkanContext* vk) {
+    VkImageCreateInfo imageInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = vk->depthFormat,
+        .extent = {vk->extent.width, vk->extent.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
     };
+    if (vkCreateImage(vk->device, &imageInfo, nullptr, &vk->depthImage) != VK_SUCCESS) {
+        SDL_Log("Create Depth Image Failed");
+        return false;
+    }
 
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(*device, &shaderModuleCreateInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create shader module!");
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(vk->device, vk->depthImage, &requirements);
+    VkMemoryAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = FindMemoryType(vk, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+    if (TrackedAllocateMemory(vk->memoryTracker, vk->device, &allocateInfo, GpuMemoryCategory::Attachment, &vk->depthMemory) != VK_SUCCESS) {
+        SDL_Log("Allocate Depth Memory Failed");
+        return false;
+    }
+    vkBindImageMemory(vk->device, vk->depthImage, vk->depthMemory, 0);
+
+    VkImageViewCreateInfo viewInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = vk->depthImage,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = vk->depthFormat,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    if (vkCreateImageView(vk->device, &viewInfo, nullptr, &vk->depthImageView) != VK_SUCCESS) {
+        SDL_Log("Create Depth Image View Failed");
+        return false;
     }
 
-    return shaderModule;
+    return true;
+}
+
+bool CreateSwapchain(VulkanContext* vk, SDL_Window* window, VkSwapchainKHR oldSwapchain) {
+    ScratchScope scratch(ScratchArena());
+    SwapchainSupportDetails swapChainSupport = FindSwapChainDetails(&vk->physicalDevice, &vk->surface, scratch);
+    if (swapChainSupport.formatCount == 0) {
+        SDL_Log("Query Surface Formats Failed");
+        return false;
+    }
+    vk->surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.formats, swapChainSupport.formatCount);
+    vk->presentMode = ChooseSwapPresentMode(swapChainSupport.presentModes, swapChainSupport.presentModeCount);
+    vk->extent = ChooseSwapExtent(&swapChainSupport.capabilities, window);
+    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
+        imageCount = swapChainSupport.capabilities.maxImageCount;
+    }
+    if (imageCount > MAX_SWAPCHAIN_IMAGES) {
+        imageCount = MAX_SWAPCHAIN_IMAGES;
+    }
+    VkSwapchainCreateInfoKHR swapchainCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+        .surface = vk->surface,
+        .minImageCount = imageCount,
+        .imageFormat = vk->surfaceFormat.format,
+        .imageColorSpace = vk->surfaceFormat.colorSpace,
+        .imageExtent = vk->extent,
+        .imageArrayLayers = 1,
+        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        .preTransform = swapChainSupport.capabilities.currentTransform,
+        .compositeAlpha =  VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+        .presentMode = vk->presentMode,
+        .clipped = VK_TRUE,
+        .oldSwapchain = oldSwapchain
+    };
+    uint32_t queueFamilyIndicies[2] = {vk->graphicsFamily, vk->presentFamily};
+    if (vk->presentFamily != vk->graphicsFamily) {
+        swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+        swapchainCreateInfo.queueFamilyIndexCount = 2;
+        swapchainCreateInfo.pQueueFamilyIndices = queueFamilyIndicies;
+    }
+    else {
+        swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        swapchainCreateInfo.queueFamilyIndexCount = 0; // Optional
+        swapchainCreateInfo.pQueueFamilyIndices = nullptr; // Optional
+    }
+    if (vkCreateSwapchainKHR(vk->device, &swapchainCreateInfo, nullptr, &vk->swapchain) != VK_SUCCESS) {
+        SDL_Log("CREATE SWAPCHAIN FAILED");
+        return false;
+    }
+
+    // Get Swap Chain Images
+    // The per image arrays live in the context, the driver may still hand out more images than asked for
+    vkGetSwapchainImagesKHR(vk->device, vk->swapchain, &vk->swapchainImageCount, nullptr);
+    if (vk->swapchainImageCount > MAX_SWAPCHAIN_IMAGES) {
+        SDL_Log("Swapchain has %u images, at most %u are supported", vk->swapchainImageCount, MAX_SWAPCHAIN_IMAGES);
+        vk->swapchainImageCount = 0;
+        return false;
+    }
+    vkGetSwapchainImagesKHR(vk->device, vk->swapchain, &vk->swapchainImageCount, vk->swapchainImages);
+
+    if (!CreateDepthBuffer(vk)) {
+        return false;
+    }
+
+    // Get Swap Chain Image Views, framebuffers and per image semaphores
+    for (int i = 0; i < vk->swapchainImageCount; i++) {
+        VkImageViewCreateInfo imageViewCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = vk->swapchainImages[i],
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = vk->surfaceFormat.format,
+            .components = {
+                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .a = VK_COMPONENT_SWIZZLE_IDENTITY
+            },
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            }
+        };
+        if (vkCreateImageView(vk->device, &imageViewCreateInfo, nullptr, &vk->swapchainImageViews[i]) != VK_SUCCESS) {
+            SDL_Log("Create Image View Failed!");
+            return false;
+        }
+
+        VkImageView attachments[2] = {vk->swapchainImageViews[i], vk->depthImageView};
+        VkFramebufferCreateInfo framebufferInfo = {
+            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+            .renderPass = vk->renderPass,
+            .attachmentCount = 2,
+            .pAttachments = attachments,
+            .width = vk->extent.width,
+            .height = vk->extent.height,
+            .layers = 1
+        };
+        if (vkCreateFramebuffer(vk->device, &framebufferInfo, nullptr, &vk->framebuffers[i]) != VK_SUCCESS) {
+            SDL_Log("Create Framebuffer Failed!");
+            return false;
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
+        };
+        vkCreateSemaphore(vk->device, &semaphoreInfo, nullptr, &vk->renderFinished[i]);
+    }
+
+    return true;
+}
+
+// Frames still in flight keep using the old objects, so they are retired
+// through the deferred deletion queue instead of waiting for the device
+bool RecreateSwapchain(AppState* state) {
+    int width = 0, height = 0;
+    SDL_GetWindowSizeInPixels(state->Window, &width, &height);
+    if (width == 0 || height == 0) {
+        return true; // minimised, try again next frame
+    }
+    state->SwapchainDirty = false;
+
+    VulkanContext* vk = &state->Vulkan;
+    const VkSwapchainKHR oldSwapchain = vk->swapchain;
+    RetireSwapchainResources(vk);
+    const bool created = CreateSwapchain(vk, state->Window, oldSwapchain);
+    DeferDestroy(vk, VK_OBJECT_TYPE_SWAPCHAIN_KHR, (uint64_t) oldSwapchain);
+    return created;
+}
+
+bool CreateRenderPass(VulkanContext* vk) {
+    VkAttachmentDescription attachments[2] = {
+        {
+            .format = vk->surfaceFormat.format,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+        },
+        {
+            .format = vk->depthFormat,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+        }
+    };
+
+    VkAttachmentReference colorAttachmentRef = {
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    };
+
+    VkAttachmentReference depthAttachmentRef = {
+        .attachment = 1,
+        .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+    };
+
+    VkSubpassDescription subpass = {
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachmentRef,
+        .pDepthStencilAttachment = &depthAttachmentRef
+    };
+
+    // Wait for the acquired image and the previous frame's depth use before clearing
+    VkSubpassDependency dependency = {
+        .srcSubpass = VK_SUBPASS_EXTERNAL,
+        .dstSubpass = 0,
+        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+        .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+    };
+
+    VkRenderPassCreateInfo renderPassInfo = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = 2,
+        .pAttachments = attachments,
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+        .dependencyCount = 1,
+        .pDependencies = &dependency
+    };
+
+    if (vkCreateRenderPass(vk->device, &renderPassInfo, nullptr, &vk->renderPass) != VK_SUCCESS) {
+        SDL_Log("Create Render Pass Failed");
+        return false;
+    }
+    return true;
+}
+
+bool CreateFrameResources(VulkanContext* vk) {
+    VkCommandPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = vk->graphicsFamily
+    };
+    if (vkCreateCommandPool(vk->device, &poolInfo, nullptr, &vk->commandPool) != VK_SUCCESS) {
+        SDL_Log("Create Command Pool Failed");
+        return false;
+    }
+
+    for (FrameResources& frame : vk->frames) {
+        VkCommandBufferAllocateInfo allocateInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = vk->commandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1
+        };
+        VkSemaphoreCreateInfo semaphoreInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
+        };
+        VkFenceCreateInfo fenceInfo = {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .flags = VK_FENCE_CREATE_SIGNALED_BIT
+        };
+
+        if (vkAllocateCommandBuffers(vk->device, &allocateInfo, &frame.commandBuffer) != VK_SUCCESS
+            || vkCreateSemaphore(vk->device, &semaphoreInfo, nullptr, &frame.imageAvailable) != VK_SUCCESS
+            || vkCreateFence(vk->device, &fenceInfo, nullptr, &frame.inFlight) != VK_SUCCESS) {
+            SDL_Log("Create Frame Resources Failed");
+            return false;
+        }
+    }
+    vk->frameIndex = 0;
+    return true;
 }
 
 /* This function runs once at startup. */
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
+    InstallMemoryHooks();
+
     uint32_t version = 0;
     if (vkEnumerateInstanceVersion(&version) == VK_SUCCESS) {
         std::cout << "Vulkan Version: "
@@ -208,11 +541,28 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     if (!state) {
         return SDL_APP_FAILURE;
     }
+    memset(state, 0, sizeof(AppState));
 
     *appstate = state;
+    VulkanContext *vk = &state->Vulkan;
+    if (!CreateArena(&state->FrameArena, FRAME_ARENA_SIZE)) {
+        return SDL_APP_FAILURE;
+    }
+
+    // Init time temporaries, released when SDL_AppInit returns
+    ScratchScope scratch(ScratchArena());
 
     state->Window = SDL_CreateWindow("Hi", 800, 600, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
 
+    // The simulation thread leads the scene pool and the main thread the render
+    // pool, both run at once so the cores are split between them
+    const int cores = SDL_max(2, SDL_GetNumLogicalCPUCores());
+    const int renderThreads = cores / 2;
+    const int sceneThreads = cores - renderThreads;
+    state->ActiveScene = new Scene((uint32_t) sceneThreads - 1);
+    InitScene(*state->ActiveScene, SCENE_ENTITY_COUNT);
+    state->RenderJobs = new JobSystem((uint32_t) renderThreads - 1);
+
     // Create Vulkan Instance
     VkApplicationInfo appInfo{
         .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -223,8 +573,7 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     };
     uint32_t extensionCount;
     char const *const *extensions = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
-    const char **validationLayers = (const char **) malloc(sizeof(char *) * 1);
-    validationLayers[0] = "VK_LAYER_KHRONOS_validation";
+    static const char *validationLayers[] = {"VK_LAYER_KHRONOS_validation"};
     VkInstanceCreateInfo instanceCreateInfo{
         .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
         .pApplicationInfo = &appInfo,
@@ -235,7 +584,10 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     };
 
 #ifdef __APPLE__
-    const char **allExts = (const char **) malloc(sizeof(char *) * (extensionCount + 1));
+    const char **allExts = scratch.AllocArray<const char *>(extensionCount + 1);
+    if (!allExts) {
+        return SDL_APP_FAILURE;
+    }
     memcpy(allExts, extensions, sizeof(*extensions) * extensionCount);
     allExts[extensionCount] = VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME;
     instanceCreateInfo.flags |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
@@ -243,40 +595,45 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     instanceCreateInfo.ppEnabledExtensionNames = allExts;
 #endif
 
-    VkInstance instance;
-    VkResult result = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+    VkResult result = vkCreateInstance(&instanceCreateInfo, nullptr, &vk->instance);
     if (result != VK_SUCCESS) {
         SDL_Log("Create Instance Failed");
         return SDL_APP_FAILURE;
     }
 
     // Create Vulkan Surface
-    VkSurfaceKHR surface;
-    if (!SDL_Vulkan_CreateSurface(state->Window, instance, nullptr, &surface)) {
+    if (!SDL_Vulkan_CreateSurface(state->Window, vk->instance, nullptr, &vk->surface)) {
         SDL_Log("Create Surface Failed");
         return SDL_APP_FAILURE;
     }
 
     // Select physical device
     uint32_t deviceCount = 0;
-    result = vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    result = vkEnumeratePhysicalDevices(vk->instance, &deviceCount, nullptr);
     if (result != VK_SUCCESS) {
         SDL_Log("EnumeratePhysicalDevices Failed");
         return SDL_APP_FAILURE;
     }
-    VkPhysicalDevice *physicalDevices = (VkPhysicalDevice *) malloc(sizeof(VkPhysicalDevice) * deviceCount);
-    result = vkEnumeratePhysicalDevices(instance, &deviceCount, physicalDevices);
+    VkPhysicalDevice *physicalDevices = scratch.AllocArray<VkPhysicalDevice>(deviceCount);
+    if (!physicalDevices) {
+        return SDL_APP_FAILURE;
+    }
+    result = vkEnumeratePhysicalDevices(vk->instance, &deviceCount, physicalDevices);
     if (result != VK_SUCCESS) {
         SDL_Log("EnumeratePhysicalDevices Failed 2");
         return SDL_APP_FAILURE;
     }
-    VkPhysicalDevice physicalDevice = ChoosePhysicalDevice(physicalDevices, deviceCount, &surface);
+    vk->physicalDevice = ChoosePhysicalDevice(physicalDevices, deviceCount, &vk->surface);
+    vkGetPhysicalDeviceProperties(vk->physicalDevice, &vk->physicalDeviceProperties);
+    vkGetPhysicalDeviceMemoryProperties(vk->physicalDevice, &vk->memoryProperties);
 
     // Create Queues
-    QueueFamilyIndices queueFamilies = FindQueueFamilies(&physicalDevice, &surface);
+    QueueFamilyIndices queueFamilies = FindQueueFamilies(&vk->physicalDevice, &vk->surface);
+    vk->graphicsFamily = queueFamilies.graphicsFamily;
+    vk->presentFamily = queueFamilies.presentFamily;
     float queuePriority = 1.0f;
     uint32_t queueFamilyCount = 1;
-    VkDeviceQueueCreateInfo *queueCreateInfos = (VkDeviceQueueCreateInfo *) malloc(sizeof(VkDeviceQueueCreateInfo));
+    VkDeviceQueueCreateInfo queueCreateInfos[2];
     queueCreateInfos[0] = VkDeviceQueueCreateInfo{
         .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
         .queueFamilyIndex = queueFamilies.graphicsFamily,
@@ -284,7 +641,6 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
         .pQueuePriorities = &queuePriority
     };
     if (queueFamilies.presentFamily != queueFamilies.graphicsFamily) {
-        queueCreateInfos = (VkDeviceQueueCreateInfo *) realloc(queueCreateInfos, sizeof(VkDeviceQueueCreateInfo) * 2);
         queueCreateInfos[1] = VkDeviceQueueCreateInfo {
             .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
             .queueFamilyIndex = queueFamilies.presentFamily,
@@ -295,355 +651,357 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
         SDL_Log("Present and Graphics are on different Queue Families");
     }
 
-    // Create logical device
-    VkPhysicalDeviceFeatures deviceFeatures{};
-    const char **deviceExtensions = (const char **) malloc(sizeof(char*));
-    deviceExtensions[0] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+    // GPU driven rendering wants drawIndirectCount (core in 1.2), multiDrawIndirect and
+    // drawIndirectFirstInstance, without them it falls back to one indirect draw per bucket
+    VkPhysicalDeviceVulkan12Features supported12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES
+    };
+    VkPhysicalDeviceFeatures2 supportedFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = vk->physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_2 ? &supported12 : nullptr
+    };
+    vkGetPhysicalDeviceFeatures2(vk->physicalDevice, &supportedFeatures);
+    vk->supportsDrawIndirectCount = supported12.drawIndirectCount && supportedFeatures.features.multiDrawIndirect;
+    vk->supportsDrawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+
+    VkPhysicalDeviceVulkan12Features enabled12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .drawIndirectCount = vk->supportsDrawIndirectCount
+    };
+    VkPhysicalDeviceFeatures2 deviceFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = supportedFeatures.pNext ? &enabled12 : nullptr
+    };
+    deviceFeatures.features.multiDrawIndirect = supportedFeatures.features.multiDrawIndirect;
+    deviceFeatures.features.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+
+    // Create logical device. Memory budget queries are optional, telemetry falls back to engine totals.
+    const char *deviceExtensions[3] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    uint32_t deviceExtensionCount = 1;
+    const bool memoryBudget = SupportsMemoryBudget(vk->physicalDevice, vk->physicalDeviceProperties.apiVersion);
+    if (memoryBudget) {
+        deviceExtensions[deviceExtensionCount++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+    }
+#ifdef __APPLE__
+    deviceExtensions[deviceExtensionCount++] = "VK_KHR_portability_subset";
+#endif
+
     VkDeviceCreateInfo deviceCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = &deviceFeatures,
         .queueCreateInfoCount = queueFamilyCount,
         .pQueueCreateInfos = queueCreateInfos,
-        .enabledExtensionCount = 1,
+        .enabledExtensionCount = deviceExtensionCount,
         .ppEnabledExtensionNames = deviceExtensions,
-        .pEnabledFeatures = &deviceFeatures
+        .pEnabledFeatures = nullptr
     };
 
-#ifdef __APPLE__
-    deviceExtensions = (const char **) realloc(deviceExtensions, sizeof(char*) * 2);
-    deviceCreateInfo.enabledExtensionCount = 2;
-    deviceExtensions[1] = "VK_KHR_portability_subset";
-    deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions;
-#endif
-
-    VkDevice device;
-    result = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+    result = vkCreateDevice(vk->physicalDevice, &deviceCreateInfo, nullptr, &vk->device);
     if (result != VK_SUCCESS) {
         SDL_Log("CREATE DEVICE FAILED");
         return SDL_APP_FAILURE;
     }
 
     // Get Queues
-    VkQueue graphicsQueue;
-    vkGetDeviceQueue(device, queueFamilies.graphicsFamily, 0, &graphicsQueue);
-    VkQueue presentQueue;
-    vkGetDeviceQueue(device, queueFamilies.presentFamily, 0, &presentQueue);
-
-    // Create Swap Chain
-    SwapchainSupportDetails swapChainSupport = FindSwapChainDetails(&physicalDevice, &surface);
-    VkSurfaceFormatKHR surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.formats, swapChainSupport.formatCount);
-    VkPresentModeKHR presentMode = ChooseSwapPresentMode(swapChainSupport.presentModes, swapChainSupport.presentModeCount);
-    VkExtent2D extent = ChooseSwapExtent(&swapChainSupport.capabilities, state->Window);
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
+    vkGetDeviceQueue(vk->device, queueFamilies.graphicsFamily, 0, &vk->graphicsQueue);
+    vkGetDeviceQueue(vk->device, queueFamilies.presentFamily, 0, &vk->presentQueue);
+
+    // Memory telemetry, set ENGINE_GPU_MEMORY_JSON to also dump the periodic reports as JSON
+    vk->memoryTracker = new GpuMemoryTracker();
+    InitGpuMemoryTracker(vk->memoryTracker, vk->physicalDevice, memoryBudget);
+    vk->memoryTracker->jsonPath = SDL_getenv("ENGINE_GPU_MEMORY_JSON");
+
+    // Render pass and swapchain. The surface format is needed by the render pass
+    // before the swapchain exists, so pick it up front.
+    SwapchainSupportDetails swapChainSupport = FindSwapChainDetails(&vk->physicalDevice, &vk->surface, scratch);
+    if (swapChainSupport.formatCount == 0) {
+        SDL_Log("Query Surface Formats Failed");
+        return SDL_APP_FAILURE;
     }
-    VkSwapchainCreateInfoKHR swapchainCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
-        .surface = surface,
-        .minImageCount = imageCount,
-        .imageFormat = surfaceFormat.format,
-        .imageColorSpace = surfaceFormat.colorSpace,
-        .imageExtent = extent,
-        .imageArrayLayers = 1,
-        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-        .preTransform = swapChainSupport.capabilities.currentTransform,
-        .compositeAlpha =  VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-        .presentMode = presentMode,
-        .clipped = VK_TRUE,
-        .oldSwapchain = VK_NULL_HANDLE
-    };
-    if (queueFamilies.presentFamily != queueFamilies.graphicsFamily) {
-        uint32_t* queueFamilyIndicies = (uint32_t*) malloc(sizeof(uint32_t) * 2);
-        queueFamilyIndicies[0] = queueFamilies.graphicsFamily;
-        queueFamilyIndicies[1] = queueFamilies.presentFamily;
+    vk->surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.formats, swapChainSupport.formatCount);
+    vk->depthFormat = VK_FORMAT_D32_SFLOAT;
 
-        swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-        swapchainCreateInfo.queueFamilyIndexCount = 2;
-        swapchainCreateInfo.pQueueFamilyIndices = queueFamilyIndicies;
-    }
-    else {
-        swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        swapchainCreateInfo.queueFamilyIndexCount = 0; // Optional
-        swapchainCreateInfo.pQueueFamilyIndices = nullptr; // Optional
-    }
-    VkSwapchainKHR swapChain;
-    if (vkCreateSwapchainKHR(device, &swapchainCreateInfo, nullptr, &swapChain) != VK_SUCCESS) {
-        SDL_Log("CREATE SWAPCHAIN FAILED");
+    if (!CreateRenderPass(vk) || !CreateSwapchain(vk, state->Window, VK_NULL_HANDLE) || !CreateFrameResources(vk)) {
         return SDL_APP_FAILURE;
     }
 
-    // Get Swap Chain Images
-    VkImage* swapChainImages;
-    uint32_t swapChainImageCount;
-    vkGetSwapchainImagesKHR(device, swapChain, &swapChainImageCount, nullptr);
-    swapChainImages = (VkImage*) malloc(sizeof(VkImage) * swapChainImageCount);
-    vkGetSwapchainImagesKHR(device, swapChain, &swapChainImageCount, swapChainImages);
-
-    // Get Swap Chain Image Views
-    VkImageView* swapChainImageViews = (VkImageView*) malloc(sizeof(VkImageView) * swapChainImageCount);
-    for (int i = 0; i < swapChainImageCount; i++) {
-        VkImageViewCreateInfo imageViewCreateInfo = {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-            .image = swapChainImages[i],
-            .viewType = VK_IMAGE_VIEW_TYPE_2D,
-            .format = surfaceFormat.format,
-            .components = {
-                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .a = VK_COMPONENT_SWIZZLE_IDENTITY
-            },
-            .subresourceRange = {
-                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .baseMipLevel = 0,
-                .levelCount = 1,
-                .baseArrayLayer = 0,
-                .layerCount = 1
-            }
-        };
-        if (vkCreateImageView(device, &imageViewCreateInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS) {
-            SDL_Log("Create Image View Failed!");
-            return SDL_APP_FAILURE;
-        }
+    state->Gpu = new GpuScene();
+    if (!CreateGpuScene(state->Gpu, vk, SCENE_ENTITY_COUNT)) {
+        SDL_Log("Create GPU Scene Failed");
+        return SDL_APP_FAILURE;
     }
 
-    size_t fragLength;
-    char* fragmentShader = LoadFile("shaders/frag.spv", fragLength);
-
-    size_t vertLength;
-    char* vertShader = LoadFile("shaders/vert.spv", vertLength);
-
-    VkShaderModule fragModule = CreateShaderModule(&device, fragmentShader, fragLength);
-    VkShaderModule vertModule = CreateShaderModule(&device, vertShader, vertLength);
-
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage = VK_SHADER_STAGE_VERTEX_BIT,
-        .module = vertModule,
-        .pName = "main"
+    const Camera initialCamera = {
+        .position = {0.0f, 50.0f, 350.0f},
+        .target = {0.0f, 0.0f, 0.0f},
+        .fovY = 1.0f,
+        .nearPlane = 0.1f,
+        .farPlane = 2000.0f
     };
+    // F12 captures the next few frames for FrameReplay, ENGINE_CAPTURE_PATH captures them after warmup
+    state->Capture = new FrameCapture();
+    state->CapturePath = SDL_getenv("ENGINE_CAPTURE_PATH");
+    state->CaptureOnStartup = state->CapturePath != nullptr;
+    if (!state->CapturePath) {
+        state->CapturePath = "capture.bin";
+    }
 
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-        .module = fragModule,
-        .pName = "main"
-    };
-
-    VkPipelineShaderStageCreateInfo* shaderStages = (VkPipelineShaderStageCreateInfo*) malloc(sizeof(VkPipelineShaderStageCreateInfo) * 2);
-    shaderStages[0] = vertShaderStageInfo;
-    shaderStages[1] = fragShaderStageInfo;
-
-    uint8_t dynamicStateCount = 2;
-    VkDynamicState* dynamicStates = (VkDynamicState*) malloc(sizeof(VkDynamicState) * dynamicStateCount);
-    dynamicStates[0] = VK_DYNAMIC_STATE_VIEWPORT;
-    dynamicStates[1] = VK_DYNAMIC_STATE_SCISSOR;
+    state->Sim = new Simulation();
+    if (!StartSimulation(state->Sim, state->ActiveScene, SCENE_ENTITY_COUNT, initialCamera)) {
+        return SDL_APP_FAILURE;
+    }
 
-    VkPipelineDynamicStateCreateInfo dynamicState = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .dynamicStateCount = dynamicStateCount,
-        .pDynamicStates = dynamicStates
-    };
+    return SDL_APP_CONTINUE; /* carry on with the program! */
+}
 
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = 0,
-        .pVertexBindingDescriptions = nullptr,
-        .vertexAttributeDescriptionCount = 0,
-        .pVertexAttributeDescriptions = nullptr,
-    };
+/* This function runs when a new event (mouse input, keypresses, etc) occurs. */
+/* SDL serialises calls to this, so it is the single producer of the simulation's input ring. */
+SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
+    AppState *state = (AppState *) appstate;
+    if (event->type == SDL_EVENT_QUIT) {
+        return SDL_APP_SUCCESS; /* end the program, reporting success to the OS. */
+    }
+    if (event->type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED) {
+        state->SwapchainDirty = true;
+    }
+    if (!state->Sim) {
+        return SDL_APP_CONTINUE;
+    }
 
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-        .primitiveRestartEnable = false
-    };
+    if ((event->type == SDL_EVENT_KEY_DOWN || event->type == SDL_EVENT_KEY_UP) && !event->key.repeat) {
+        PushInput(state->Sim, InputEvent{
+            .timestampNS = event->key.timestamp,
+            .type = event->key.down ? InputEvent::Type::KeyDown : InputEvent::Type::KeyUp,
+            .key = event->key.key
+        });
+    }
+    else if (event->type == SDL_EVENT_MOUSE_WHEEL) {
+        PushInput(state->Sim, InputEvent{
+            .timestampNS = event->wheel.timestamp,
+            .type = InputEvent::Type::MouseWheel,
+            .wheel = event->wheel.y
+        });
+    }
 
-    VkViewport viewport = {
-        .x = 0.0f,
-        .y = 0.0f,
-        .width = (float)extent.width,
-        .height = (float)extent.height,
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f
-    };
+    if (event->type == SDL_EVENT_KEY_DOWN && event->key.key == SDLK_F12 && !event->key.repeat
+        && !IsCapturing(state->Capture)) {
+        BeginCapture(state->Capture, state->CapturePath, CAPTURE_FRAME_COUNT, state->Gpu->maxInstances);
+    }
+    return SDL_APP_CONTINUE; /* carry on with the program! */
+}
 
-    VkRect2D scissor = {
-        .offset = {
-            .x = 0,
-            .y = 0
-        },
-        .extent = extent
-    };
+/* capture is null unless this frame is being captured, it mirrors every command recorded here */
+bool RecordFrame(AppState *state, VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t frameSlot, const float clearColor[3],
+                 FrameCapture *capture) {
+    VulkanContext *vk = &state->Vulkan;
 
-    VkPipelineViewportStateCreateInfo viewportState = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .viewportCount = 1,
-        .pViewports = &viewport,
-        .scissorCount = 1,
-        .pScissors = &scissor
+    VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
     };
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        return false;
+    }
 
-    VkPipelineRasterizationStateCreateInfo rasterizer = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .depthClampEnable = false,
-        .polygonMode = VK_POLYGON_MODE_FILL,
-        .lineWidth = 1.0f,
-        .cullMode = VK_CULL_MODE_BACK_BIT,
-        .frontFace = VK_FRONT_FACE_CLOCKWISE,
-        .depthBiasEnable = false,
-        .depthBiasConstantFactor = 0.0f,
-        .depthBiasClamp = 0.0f,
-        .depthBiasSlopeFactor = 0.0f
-    };
+    RecordGpuCulling(state->Gpu, commandBuffer, frameSlot);
+    if (capture) {
+        CaptureSimpleCommand(capture, CaptureCommand::Cull);
+    }
 
-    VkPipelineMultisampleStateCreateInfo multisampling = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .sampleShadingEnable = false,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-        .minSampleShading = 1.0f,
-        .pSampleMask = nullptr,
-        .alphaToCoverageEnable = false,
-        .alphaToOneEnable = false
+    VkClearValue clearValues[2];
+    clearValues[0].color = {{clearColor[0], clearColor[1], clearColor[2], 1.0f}};
+    clearValues[1].depthStencil = {1.0f, 0};
+
+    VkRenderPassBeginInfo renderPassInfo = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .renderPass = vk->renderPass,
+        .framebuffer = vk->framebuffers[imageIndex],
+        .renderArea = {{0, 0}, vk->extent},
+        .clearValueCount = 2,
+        .pClearValues = clearValues
     };
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    RecordGpuDraw(state->Gpu, vk, commandBuffer, frameSlot);
+    vkCmdEndRenderPass(commandBuffer);
+    if (capture) {
+        CaptureBeginRenderPass(capture, clearColor);
+        CaptureSimpleCommand(capture, CaptureCommand::DrawScene);
+        CaptureSimpleCommand(capture, CaptureCommand::EndRenderPass);
+    }
 
-    VkPipelineColorBlendAttachmentState colorBlendAttachment = {
-        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-        .blendEnable = false,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .colorBlendOp = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .alphaBlendOp = VK_BLEND_OP_ADD
-    };
+    return vkEndCommandBuffer(commandBuffer) == VK_SUCCESS;
+}
 
-    VkPipelineColorBlendStateCreateInfo colorBlending = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .logicOpEnable = false,
-        .logicOp = VK_LOGIC_OP_COPY,
-        .attachmentCount = 1,
-        .pAttachments = &colorBlendAttachment,
-        .blendConstants[0] = 0.0f,
-        .blendConstants[1] = 0.0f,
-        .blendConstants[2] = 0.0f,
-        .blendConstants[3] = 0.0f
-    };
+/* This function runs once per frame, and is the heart of the program. */
+SDL_AppResult SDL_AppIterate(void *appstate) {
+    AppState *state = (AppState *) appstate;
+    VulkanContext *vk = &state->Vulkan;
+    const HeapCounters heapAtStart = GetHeapCounters();
+    ResetArena(&state->FrameArena);
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 0,
-        .pSetLayouts = nullptr,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = nullptr,
+    const Uint64 ticks = SDL_GetTicks();
+    const double now = ((double) ticks) / 1000.0; /* convert from milliseconds to seconds. */
+    /* choose the color for the frame we will draw. The sine wave trick makes it fade between colors smoothly. */
+    const float clearColor[3] = {
+        (float) (0.1 + 0.1 * SDL_sin(now)),
+        (float) (0.1 + 0.1 * SDL_sin(now + SDL_PI_D * 2 / 3)),
+        (float) (0.1 + 0.1 * SDL_sin(now + SDL_PI_D * 4 / 3))
     };
 
-    VkPipelineLayout pipelineLayout;
+    const uint32_t frameSlot = vk->frameIndex;
+    FrameResources *frame = &vk->frames[frameSlot];
+    vkWaitForFences(vk->device, 1, &frame->inFlight, VK_TRUE, UINT64_MAX);
+    FlushDeferredDeletions(vk, frameSlot);
+    UpdateGpuMemoryBudget(vk->memoryTracker);
 
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-        SDL_Log("Create Pipeline Failed");
+    if (state->SwapchainDirty && !RecreateSwapchain(state)) {
         return SDL_APP_FAILURE;
     }
 
-    VkAttachmentDescription colorAttachment = {
-        .format = surfaceFormat.format,
-        .samples = VK_SAMPLE_COUNT_1_BIT,
-        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
-    };
-
-    VkAttachmentReference colorAttachmentRef = {
-        .attachment = 0,
-        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-    };
+    uint32_t imageIndex;
+    VkResult result = vkAcquireNextImageKHR(vk->device, vk->swapchain, UINT64_MAX, frame->imageAvailable, VK_NULL_HANDLE, &imageIndex);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        state->SwapchainDirty = true;
+        return SDL_APP_CONTINUE;
+    }
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        SDL_Log("Acquire Swapchain Image Failed");
+        return SDL_APP_FAILURE;
+    }
+    vkResetFences(vk->device, 1, &frame->inFlight);
 
-    VkSubpassDescription subpass = {
-        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-        .colorAttachmentCount = 1,
-        .pColorAttachments = &colorAttachmentRef
-    };
+    if (state->CaptureOnStartup && state->FrameNumber == WARMUP_FRAMES && !IsCapturing(state->Capture)) {
+        BeginCapture(state->Capture, state->CapturePath, CAPTURE_FRAME_COUNT, state->Gpu->maxInstances);
+    }
+    FrameCapture *capture = IsCapturing(state->Capture) ? state->Capture : nullptr;
+    if (capture) {
+        CaptureBeginFrame(capture, state->FrameNumber, vk->extent.width, vk->extent.height);
+    }
 
-    VkRenderPass renderPass;
-    VkRenderPassCreateInfo renderPassInfo = {
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-        .attachmentCount = 1,
-        .pAttachments = &colorAttachment,
-        .subpassCount = 1,
-        .pSubpasses = &subpass
-    };
+    /* the fence guarantees the GPU is done with this slot's instance buffer */
+    const float aspect = (float) vk->extent.width / (float) vk->extent.height;
+    /* blend the newest simulation state towards the present */
+    const SimSnapshot *snapshot = AcquireSnapshot(state->Sim);
+    const float alpha = SnapshotAlpha(state->Sim, snapshot, SDL_GetTicksNS());
+    const Camera camera = InterpolateCamera(snapshot, alpha);
+    if (!UpdateGpuInstances(state->Gpu, snapshot, alpha, camera, aspect, frameSlot, *state->RenderJobs, &state->FrameArena)) {
+        SDL_Log("Update GPU Instances Failed");
+        return SDL_APP_FAILURE;
+    }
+    if (capture) {
+        CaptureUpdateInstances(capture, snapshot, alpha, camera, aspect);
+    }
 
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
-        SDL_Log("Create Render Pass Failed");
+    vkResetCommandBuffer(frame->commandBuffer, 0);
+    if (!RecordFrame(state, frame->commandBuffer, imageIndex, frameSlot, clearColor, capture)) {
+        SDL_Log("Record Command Buffer Failed");
         return SDL_APP_FAILURE;
     }
 
-    VkGraphicsPipelineCreateInfo pipelineInfo = {
-        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .stageCount = 2,
-        .pStages = shaderStages,
-        .pVertexInputState = &vertexInputInfo,
-        .pInputAssemblyState = &inputAssembly,
-        .pViewportState = &viewportState,
-        .pRasterizationState = &rasterizer,
-        .pMultisampleState = &multisampling,
-        .pDepthStencilState = nullptr,
-        .pColorBlendState = &colorBlending,
-        .pDynamicState = &dynamicState,
-        .layout = pipelineLayout,
-        .renderPass = renderPass,
-        .subpass = 0
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &frame->imageAvailable,
+        .pWaitDstStageMask = &waitStage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &frame->commandBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &vk->renderFinished[imageIndex]
     };
-
-    VkPipeline graphicsPipeline;
-
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-        SDL_Log("Create Graphics Pipeline Failed");
+    if (vkQueueSubmit(vk->graphicsQueue, 1, &submitInfo, frame->inFlight) != VK_SUCCESS) {
+        SDL_Log("Queue Submit Failed");
         return SDL_APP_FAILURE;
     }
-
-    //free(allExts);
-    free(validationLayers);
-    free(physicalDevices);
-    free(deviceExtensions);
-    free(queueCreateInfos);
-    free(swapChainImages);
-    free(swapChainImageViews);
-    free(dynamicStates);
-    free(shaderStages);
-    return SDL_APP_CONTINUE; /* carry on with the program! */
-}
-
-/* This function runs when a new event (mouse input, keypresses, etc) occurs. */
-SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
-    if (event->type == SDL_EVENT_QUIT) {
-        return SDL_APP_SUCCESS; /* end the program, reporting success to the OS. */
+    vk->lastSubmittedSlot = frameSlot;
+    if (capture) {
+        CaptureEndFrame(capture);
     }
-    return SDL_APP_CONTINUE; /* carry on with the program! */
-}
 
-/* This function runs once per frame, and is the heart of the program. */
-SDL_AppResult SDL_AppIterate(void *appstate) {
-    const double now = ((double) SDL_GetTicks()) / 1000.0; /* convert from milliseconds to seconds. */
-    /* choose the color for the frame we will draw. The sine wave trick makes it fade between colors smoothly. */
-    const float red = (float) (0.5 + 0.5 * SDL_sin(now));
-    const float green = (float) (0.5 + 0.5 * SDL_sin(now + SDL_PI_D * 2 / 3));
-    const float blue = (float) (0.5 + 0.5 * SDL_sin(now + SDL_PI_D * 4 / 3));
-    SDL_SetRenderDrawColorFloat(renderer, red, green, blue, SDL_ALPHA_OPAQUE_FLOAT); /* new color, full alpha. */
-
-    /* clear the window to the draw color. */
-    SDL_RenderClear(renderer);
+    VkPresentInfoKHR presentInfo = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &vk->renderFinished[imageIndex],
+        .swapchainCount = 1,
+        .pSwapchains = &vk->swapchain,
+        .pImageIndices = &imageIndex
+    };
+    result = vkQueuePresentKHR(vk->presentQueue, &presentInfo);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        state->SwapchainDirty = true;
+    }
 
-    /* put the newly-cleared rendering on the screen. */
-    SDL_RenderPresent(renderer);
+    vk->frameIndex = (vk->frameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
 
+    /* the steady state loop should not touch the heap, report it when it does. Captured frames
+       allocate the capture stream and the writer thread and are left out. */
+    state->FrameNumber++;
+    if (state->FrameNumber > WARMUP_FRAMES) {
+        if (!capture) {
+            state->SteadyStateAllocations += GetHeapCounters().allocations - heapAtStart.allocations;
+        }
+        if (state->FrameNumber % HEAP_REPORT_INTERVAL == 0) {
+            SDL_Log("Frames %llu-%llu: %llu heap allocations, frame arena high water %zu bytes",
+                    (unsigned long long) (state->FrameNumber - HEAP_REPORT_INTERVAL + 1),
+                    (unsigned long long) state->FrameNumber,
+                    (unsigned long long) state->SteadyStateAllocations,
+                    state->FrameArena.highWater);
+            state->SteadyStateAllocations = 0;
+        }
+    }
     return SDL_APP_CONTINUE; /* carry on with the program! */
 }
 
 /* This function runs once at shutdown. */
 void SDL_AppQuit(void *appstate, SDL_AppResult result) {
     /* SDL will clean up the window/renderer for us. */
+    AppState *state = (AppState *) appstate;
+    if (!state) {
+        return;
+    }
+
+    /* the simulation thread uses the scene, stop it before anything is torn down */
+    if (state->Sim) {
+        StopSimulation(state->Sim);
+    }
+
+    VulkanContext *vk = &state->Vulkan;
+    if (vk->device) {
+        vkDeviceWaitIdle(vk->device);
+        FlushAllDeferredDeletions(vk);
+        if (state->Gpu) {
+            DestroyGpuScene(state->Gpu, vk);
+        }
+        for (FrameResources &frame : vk->frames) {
+            vkDestroySemaphore(vk->device, frame.imageAvailable, nullptr);
+            vkDestroyFence(vk->device, frame.inFlight, nullptr);
+        }
+        vkDestroyCommandPool(vk->device, vk->commandPool, nullptr);
+        if (vk->swapchain) {
+            DestroySwapchain(vk);
+        }
+        vkDestroyRenderPass(vk->device, vk->renderPass, nullptr);
+        vkDestroyDevice(vk->device, nullptr);
+
+        const GpuMemoryStats &memoryStats = GetGpuMemoryStats(vk->memoryTracker);
+        for (uint32_t c = 0; c < GPU_MEMORY_CATEGORY_COUNT; c++) {
+            if (memoryStats.categoryAllocations[c] > 0) {
+                SDL_Log("Leaked %u device allocations in %s", memoryStats.categoryAllocations[c],
+                        GpuMemoryCategoryName((GpuMemoryCategory) c));
+            }
+        }
+        delete vk->memoryTracker;
+    }
+    if (vk->instance) {
+        vkDestroySurfaceKHR(vk->instance, vk->surface, nullptr);
+        vkDestroyInstance(vk->instance, nullptr);
+    }
+
+    delete state->Capture;
+    delete state->Gpu;
+    delete state->Sim;
+    delete state->RenderJobs;
+    delete state->ActiveScene;
+    DestroyArena(&state->FrameArena);
+    free(state);
 }
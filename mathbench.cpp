@@ -0,0 +1,208 @@
+// Microbenchmarks for the batched math kernels against their scalar reference
+// versions. Also checks that both paths agree before reporting timings.
+//
+//   MathBenchmark [objectCount] [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "mathkernels.h"
+
+struct SoaScene {
+    std::vector<float> px, py, pz, qx, qy, qz, qw, scale;
+    std::vector<float> wx, wy, wz;
+    std::vector<float> sx, sy, sz, radius;
+    std::vector<float> ex, ey, ez;
+
+    TransformStreams Transforms() const {
+        return {px.data(), py.data(), pz.data(), qx.data(), qy.data(), qz.data(), qw.data(), scale.data()};
+    }
+};
+
+static float RandomFloat(uint32_t& state, float min, float max) {
+    state = state * 1664525u + 1013904223u;
+    return min + (max - min) * ((float) (state >> 8) / (float) (1u << 24));
+}
+
+static void Fill(SoaScene& scene, uint32_t count) {
+    std::vector<float>* streams[] = {
+        &scene.px, &scene.py, &scene.pz, &scene.qx, &scene.qy, &scene.qz, &scene.qw, &scene.scale,
+        &scene.wx, &scene.wy, &scene.wz, &scene.sx, &scene.sy, &scene.sz, &scene.radius,
+        &scene.ex, &scene.ey, &scene.ez
+    };
+    for (std::vector<float>* stream : streams) {
+        stream->resize(count);
+    }
+
+    uint32_t rng = 12345;
+    for (uint32_t i = 0; i < count; i++) {
+        scene.px[i] = RandomFloat(rng, -500.0f, 500.0f);
+        scene.py[i] = RandomFloat(rng, -500.0f, 500.0f);
+        scene.pz[i] = RandomFloat(rng, -500.0f, 500.0f);
+        const Quat q = QuatFromAxisAngle({RandomFloat(rng, -1.0f, 1.0f), RandomFloat(rng, -1.0f, 1.0f), 1.0f},
+                                         RandomFloat(rng, 0.0f, 6.28f));
+        scene.qx[i] = q.x;
+        scene.qy[i] = q.y;
+        scene.qz[i] = q.z;
+        scene.qw[i] = q.w;
+        scene.scale[i] = RandomFloat(rng, 0.5f, 2.0f);
+        scene.wx[i] = RandomFloat(rng, -1.0f, 1.0f);
+        scene.wy[i] = RandomFloat(rng, -1.0f, 1.0f);
+        scene.wz[i] = RandomFloat(rng, -1.0f, 1.0f);
+        scene.sx[i] = RandomFloat(rng, -0.5f, 0.5f);
+        scene.sy[i] = RandomFloat(rng, -0.5f, 0.5f);
+        scene.sz[i] = RandomFloat(rng, -0.5f, 0.5f);
+        scene.radius[i] = RandomFloat(rng, 0.5f, 2.0f);
+        scene.ex[i] = RandomFloat(rng, 0.25f, 1.0f);
+        scene.ey[i] = RandomFloat(rng, 0.25f, 1.0f);
+        scene.ez[i] = RandomFloat(rng, 0.25f, 1.0f);
+    }
+}
+
+// Best of `iterations` runs, in nanoseconds per object
+template<typename Fn>
+static double Measure(uint32_t count, uint32_t iterations, Fn&& fn) {
+    double best = 1e30;
+    for (uint32_t i = 0; i < iterations; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto end = std::chrono::steady_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        if (ns < best) {
+            best = ns;
+        }
+    }
+    return best / count;
+}
+
+static void Report(const char* name, double simd, double scalar) {
+    printf("%-24s %8.3f ns/obj  scalar %8.3f ns/obj  speedup %5.2fx\n", name, simd, scalar, scalar / simd);
+}
+
+static bool Compare(const char* name, const float* a, const float* b, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const float diff = std::fabs(a[i] - b[i]);
+        if (diff > 1e-3f * (1.0f + std::fabs(b[i]))) {
+            printf("%s mismatch at %zu: %f vs %f\n", name, i, a[i], b[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Cull kernels must produce the same visible set in the same order, not just the same count
+static bool CompareIndices(const char* name, const uint32_t* a, uint32_t countA, const uint32_t* b, uint32_t countB) {
+    if (countA != countB) {
+        printf("%s visible count mismatch: %u vs %u\n", name, countA, countB);
+        return false;
+    }
+    for (uint32_t i = 0; i < countA; i++) {
+        if (a[i] != b[i]) {
+            printf("%s mismatch at %u: index %u vs %u\n", name, i, a[i], b[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const uint32_t count = argc > 1 ? (uint32_t) strtoul(argv[1], nullptr, 10) : 1000003;
+    const uint32_t iterations = argc > 2 ? (uint32_t) strtoul(argv[2], nullptr, 10) : 20;
+
+    printf("Math kernels: %s, width %d, %u objects, best of %u\n", MathSimdName(), MATH_SIMD_WIDTH, count, iterations);
+
+    SoaScene scene;
+    Fill(scene, count);
+    const TransformStreams transforms = scene.Transforms();
+
+    std::vector<Mat4> matrices(count), matricesScalar(count);
+    std::vector<float> out[12];
+    for (std::vector<float>& stream : out) {
+        stream.resize(count);
+    }
+    std::vector<uint32_t> visible(count), visibleScalar(count);
+
+    const SphereStreams localSpheres = {scene.sx.data(), scene.sy.data(), scene.sz.data(), scene.radius.data()};
+    const SphereStreams worldSpheres = {out[0].data(), out[1].data(), out[2].data(), out[3].data()};
+    const SphereStreams worldSpheresScalar = {out[4].data(), out[5].data(), out[6].data(), out[7].data()};
+    const AabbStreams localBoxes = {scene.sx.data(), scene.sy.data(), scene.sz.data(), scene.ex.data(), scene.ey.data(), scene.ez.data()};
+    const AabbStreams worldBoxes = {out[0].data(), out[1].data(), out[2].data(), out[3].data(), out[4].data(), out[5].data()};
+    const AabbStreams worldBoxesScalar = {out[6].data(), out[7].data(), out[8].data(), out[9].data(), out[10].data(), out[11].data()};
+
+    const Mat4 projection = Mat4Perspective(1.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+    const Mat4 view = Mat4LookAt({0.0f, 0.0f, 0.0f}, {1.0f, 0.2f, 0.5f}, {0.0f, 1.0f, 0.0f});
+    const Frustum frustum = FrustumFromViewProjection(Mat4Mul(projection, view));
+
+    bool ok = true;
+
+    ComposeWorldMatrices(transforms, count, matrices.data());
+    ComposeWorldMatricesScalar(transforms, count, matricesScalar.data());
+    ok &= Compare("ComposeWorldMatrices", matrices[0].m, matricesScalar[0].m, (size_t) count * 16);
+    Report("ComposeWorldMatrices",
+           Measure(count, iterations, [&] { ComposeWorldMatrices(transforms, count, matrices.data()); }),
+           Measure(count, iterations, [&] { ComposeWorldMatricesScalar(transforms, count, matricesScalar.data()); }));
+
+    // Blend towards the same transforms with every rotation advanced by the angular velocity
+    SoaScene advanced = scene;
+    IntegrateRotations(advanced.qx.data(), advanced.qy.data(), advanced.qz.data(), advanced.qw.data(),
+                       scene.wx.data(), scene.wy.data(), scene.wz.data(), 1.0f / 30.0f, count);
+    const TransformStreams advancedTransforms = advanced.Transforms();
+    ComposeInterpolatedWorldMatrices(transforms, advancedTransforms, 0.4f, count, matrices.data());
+    ComposeInterpolatedWorldMatricesScalar(transforms, advancedTransforms, 0.4f, count, matricesScalar.data());
+    ok &= Compare("ComposeInterpolated", matrices[0].m, matricesScalar[0].m, (size_t) count * 16);
+    Report("ComposeInterpolated",
+           Measure(count, iterations, [&] { ComposeInterpolatedWorldMatrices(transforms, advancedTransforms, 0.4f, count, matrices.data()); }),
+           Measure(count, iterations, [&] { ComposeInterpolatedWorldMatricesScalar(transforms, advancedTransforms, 0.4f, count, matricesScalar.data()); }));
+
+    TransformSpheres(transforms, localSpheres, count, worldSpheres);
+    TransformSpheresScalar(transforms, localSpheres, count, worldSpheresScalar);
+    for (int s = 0; s < 4; s++) {
+        ok &= Compare("TransformSpheres", out[s].data(), out[s + 4].data(), count);
+    }
+    Report("TransformSpheres",
+           Measure(count, iterations, [&] { TransformSpheres(transforms, localSpheres, count, worldSpheres); }),
+           Measure(count, iterations, [&] { TransformSpheresScalar(transforms, localSpheres, count, worldSpheresScalar); }));
+
+    const uint32_t sphereVisible = CullSpheres(frustum, worldSpheres, count, 0, visible.data());
+    const uint32_t sphereVisibleScalar = CullSpheresScalar(frustum, worldSpheres, count, 0, visibleScalar.data());
+    ok &= CompareIndices("CullSpheres", visible.data(), sphereVisible, visibleScalar.data(), sphereVisibleScalar);
+    Report("CullSpheres",
+           Measure(count, iterations, [&] { CullSpheres(frustum, worldSpheres, count, 0, visible.data()); }),
+           Measure(count, iterations, [&] { CullSpheresScalar(frustum, worldSpheres, count, 0, visibleScalar.data()); }));
+
+    TransformAabbs(transforms, localBoxes, count, worldBoxes);
+    TransformAabbsScalar(transforms, localBoxes, count, worldBoxesScalar);
+    for (int s = 0; s < 6; s++) {
+        ok &= Compare("TransformAabbs", out[s].data(), out[s + 6].data(), count);
+    }
+    Report("TransformAabbs",
+           Measure(count, iterations, [&] { TransformAabbs(transforms, localBoxes, count, worldBoxes); }),
+           Measure(count, iterations, [&] { TransformAabbsScalar(transforms, localBoxes, count, worldBoxesScalar); }));
+
+    const uint32_t boxVisible = CullAabbs(frustum, worldBoxes, count, 0, visible.data());
+    const uint32_t boxVisibleScalar = CullAabbsScalar(frustum, worldBoxes, count, 0, visibleScalar.data());
+    ok &= CompareIndices("CullAabbs", visible.data(), boxVisible, visibleScalar.data(), boxVisibleScalar);
+    Report("CullAabbs",
+           Measure(count, iterations, [&] { CullAabbs(frustum, worldBoxes, count, 0, visible.data()); }),
+           Measure(count, iterations, [&] { CullAabbsScalar(frustum, worldBoxes, count, 0, visibleScalar.data()); }));
+
+    // Integration mutates its input, so both variants run on their own copy
+    std::vector<float> q[8] = {scene.qx, scene.qy, scene.qz, scene.qw, scene.qx, scene.qy, scene.qz, scene.qw};
+    Report("IntegrateRotations",
+           Measure(count, iterations, [&] {
+               IntegrateRotations(q[0].data(), q[1].data(), q[2].data(), q[3].data(),
+                                  scene.wx.data(), scene.wy.data(), scene.wz.data(), 0.016f, count);
+           }),
+           Measure(count, iterations, [&] {
+               IntegrateRotationsScalar(q[4].data(), q[5].data(), q[6].data(), q[7].data(),
+                                        scene.wx.data(), scene.wy.data(), scene.wz.data(), 0.016f, count);
+           }));
+    for (int s = 0; s < 4; s++) {
+        ok &= Compare("IntegrateRotations", q[s].data(), q[s + 4].data(), count);
+    }
+
+    printf("Visible: %u spheres, %u boxes\n", sphereVisible, boxVisible);
+    printf(ok ? "SIMD and scalar results match\n" : "SIMD and scalar results DIFFER\n");
+    return ok ? 0 : 1;
+}
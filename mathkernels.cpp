@@ -0,0 +1,397 @@
+#include "mathkernels.h"
+
+// Every kernel is written once against a small float-vector wrapper and
+// instantiated for the widest available type plus Float1 for tails and the
+// scalar reference versions.
+
+namespace {
+
+struct Float1 {
+    static constexpr uint32_t Width = 1;
+    float v;
+
+    static Float1 Load(const float* p) { return {*p}; }
+    static Float1 Set(const float s) { return {s}; }
+    void Store(float* p) const { *p = v; }
+};
+
+inline Float1 operator+(const Float1 a, const Float1 b) { return {a.v + b.v}; }
+inline Float1 operator-(const Float1 a, const Float1 b) { return {a.v - b.v}; }
+inline Float1 operator*(const Float1 a, const Float1 b) { return {a.v * b.v}; }
+inline Float1 operator/(const Float1 a, const Float1 b) { return {a.v / b.v}; }
+inline Float1 MulAdd(const Float1 a, const Float1 b, const Float1 c) { return {a.v * b.v + c.v}; }
+inline Float1 Abs(const Float1 a) { return {std::fabs(a.v)}; }
+inline Float1 Sqrt(const Float1 a) { return {std::sqrt(a.v)}; }
+inline uint32_t LessThanMask(const Float1 a, const Float1 b) { return a.v < b.v ? 1u : 0u; }
+
+inline void StoreMatrices(const Float1* columns, Mat4* out) {
+    for (int k = 0; k < 16; k++) {
+        out->m[k] = columns[k].v;
+    }
+}
+
+#if defined(MATH_SIMD_SSE)
+struct Float4 {
+    static constexpr uint32_t Width = 4;
+    __m128 v;
+
+    static Float4 Load(const float* p) { return {_mm_loadu_ps(p)}; }
+    static Float4 Set(const float s) { return {_mm_set1_ps(s)}; }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+inline Float4 operator+(const Float4 a, const Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Float4 operator-(const Float4 a, const Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Float4 operator*(const Float4 a, const Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Float4 operator/(const Float4 a, const Float4 b) { return {_mm_div_ps(a.v, b.v)}; }
+inline Float4 MulAdd(const Float4 a, const Float4 b, const Float4 c) { return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)}; }
+inline Float4 Abs(const Float4 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+inline Float4 Sqrt(const Float4 a) { return {_mm_sqrt_ps(a.v)}; }
+inline uint32_t LessThanMask(const Float4 a, const Float4 b) { return (uint32_t) _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+
+// Transposes each column's four row registers into four consecutive matrices
+inline void StoreColumn4(__m128 r0, __m128 r1, __m128 r2, __m128 r3, Mat4* out, int column) {
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_store_ps(&out[0].m[column * 4], r0);
+    _mm_store_ps(&out[1].m[column * 4], r1);
+    _mm_store_ps(&out[2].m[column * 4], r2);
+    _mm_store_ps(&out[3].m[column * 4], r3);
+}
+
+inline void StoreMatrices(const Float4* columns, Mat4* out) {
+    for (int c = 0; c < 4; c++) {
+        StoreColumn4(columns[c * 4 + 0].v, columns[c * 4 + 1].v, columns[c * 4 + 2].v, columns[c * 4 + 3].v, out, c);
+    }
+}
+#endif
+
+#if defined(MATH_SIMD_AVX2)
+struct Float8 {
+    static constexpr uint32_t Width = 8;
+    __m256 v;
+
+    static Float8 Load(const float* p) { return {_mm256_loadu_ps(p)}; }
+    static Float8 Set(const float s) { return {_mm256_set1_ps(s)}; }
+    void Store(float* p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline Float8 operator+(const Float8 a, const Float8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline Float8 operator-(const Float8 a, const Float8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline Float8 operator*(const Float8 a, const Float8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline Float8 operator/(const Float8 a, const Float8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline Float8 MulAdd(const Float8 a, const Float8 b, const Float8 c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+inline Float8 Abs(const Float8 a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+inline Float8 Sqrt(const Float8 a) { return {_mm256_sqrt_ps(a.v)}; }
+inline uint32_t LessThanMask(const Float8 a, const Float8 b) { return (uint32_t) _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+
+inline void StoreMatrices(const Float8* columns, Mat4* out) {
+    for (int c = 0; c < 4; c++) {
+        const __m256 r0 = columns[c * 4 + 0].v;
+        const __m256 r1 = columns[c * 4 + 1].v;
+        const __m256 r2 = columns[c * 4 + 2].v;
+        const __m256 r3 = columns[c * 4 + 3].v;
+        StoreColumn4(_mm256_castps256_ps128(r0), _mm256_castps256_ps128(r1),
+                     _mm256_castps256_ps128(r2), _mm256_castps256_ps128(r3), out, c);
+        StoreColumn4(_mm256_extractf128_ps(r0, 1), _mm256_extractf128_ps(r1, 1),
+                     _mm256_extractf128_ps(r2, 1), _mm256_extractf128_ps(r3, 1), out + 4, c);
+    }
+}
+
+typedef Float8 FloatN;
+#elif defined(MATH_SIMD_SSE)
+typedef Float4 FloatN;
+#endif
+
+#if defined(MATH_SIMD_NEON)
+struct Float4 {
+    static constexpr uint32_t Width = 4;
+    float32x4_t v;
+
+    static Float4 Load(const float* p) { return {vld1q_f32(p)}; }
+    static Float4 Set(const float s) { return {vdupq_n_f32(s)}; }
+    void Store(float* p) const { vst1q_f32(p, v); }
+};
+
+inline Float4 operator+(const Float4 a, const Float4 b) { return {vaddq_f32(a.v, b.v)}; }
+inline Float4 operator-(const Float4 a, const Float4 b) { return {vsubq_f32(a.v, b.v)}; }
+inline Float4 operator*(const Float4 a, const Float4 b) { return {vmulq_f32(a.v, b.v)}; }
+inline Float4 operator/(const Float4 a, const Float4 b) { return {vdivq_f32(a.v, b.v)}; }
+inline Float4 MulAdd(const Float4 a, const Float4 b, const Float4 c) { return {vfmaq_f32(c.v, a.v, b.v)}; }
+inline Float4 Abs(const Float4 a) { return {vabsq_f32(a.v)}; }
+inline Float4 Sqrt(const Float4 a) { return {vsqrtq_f32(a.v)}; }
+
+inline uint32_t LessThanMask(const Float4 a, const Float4 b) {
+    static const uint32_t laneBits[4] = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(vcltq_f32(a.v, b.v), vld1q_u32(laneBits)));
+}
+
+inline void StoreMatrices(const Float4* columns, Mat4* out) {
+    for (int c = 0; c < 4; c++) {
+        const float32x4x2_t t01 = vtrnq_f32(columns[c * 4 + 0].v, columns[c * 4 + 1].v);
+        const float32x4x2_t t23 = vtrnq_f32(columns[c * 4 + 2].v, columns[c * 4 + 3].v);
+        vst1q_f32(&out[0].m[c * 4], vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+        vst1q_f32(&out[1].m[c * 4], vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+        vst1q_f32(&out[2].m[c * 4], vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+        vst1q_f32(&out[3].m[c * 4], vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+    }
+}
+
+typedef Float4 FloatN;
+#endif
+
+#if defined(MATH_SIMD_SCALAR)
+typedef Float1 FloatN;
+#endif
+
+// fn(F(), i) for each full vector of objects, then Float1 for the remainder
+template<typename Fn>
+void RunWide(const uint32_t count, Fn&& fn) {
+    uint32_t i = 0;
+    for (; i + FloatN::Width <= count; i += FloatN::Width) {
+        fn(FloatN(), i);
+    }
+    for (; i < count; i++) {
+        fn(Float1(), i);
+    }
+}
+
+template<typename Fn>
+void RunScalar(const uint32_t count, Fn&& fn) {
+    for (uint32_t i = 0; i < count; i++) {
+        fn(Float1(), i);
+    }
+}
+
+// fn returns a bitmask of culled lanes; surviving indices are compacted without branches
+template<typename Fn>
+uint32_t RunCull(const uint32_t count, const uint32_t baseIndex, uint32_t* visibleIndices, bool wide, Fn&& fn) {
+    uint32_t visibleCount = 0;
+    uint32_t i = 0;
+
+    if (wide) {
+        for (; i + FloatN::Width <= count; i += FloatN::Width) {
+            const uint32_t culled = fn(FloatN(), i);
+            for (uint32_t lane = 0; lane < FloatN::Width; lane++) {
+                visibleIndices[visibleCount] = baseIndex + i + lane;
+                visibleCount += ((culled >> lane) & 1) ^ 1;
+            }
+        }
+    }
+    for (; i < count; i++) {
+        const uint32_t culled = fn(Float1(), i);
+        visibleIndices[visibleCount] = baseIndex + i;
+        visibleCount += culled ^ 1;
+    }
+
+    return visibleCount;
+}
+
+// Rotation * scale as a column-major 3x3, r[column * 3 + row]
+template<typename F>
+void RotationScaleMatrix(const F x, const F y, const F z, const F w, const F s, F r[9]) {
+    const F one = F::Set(1.0f);
+    const F two = F::Set(2.0f);
+    const F s2 = s * two;
+
+    const F xx = x * x, yy = y * y, zz = z * z;
+    const F xy = x * y, xz = x * z, yz = y * z;
+    const F wx = w * x, wy = w * y, wz = w * z;
+
+    r[0] = (one - two * (yy + zz)) * s;
+    r[1] = (xy + wz) * s2;
+    r[2] = (xz - wy) * s2;
+    r[3] = (xy - wz) * s2;
+    r[4] = (one - two * (xx + zz)) * s;
+    r[5] = (yz + wx) * s2;
+    r[6] = (xz + wy) * s2;
+    r[7] = (yz - wx) * s2;
+    r[8] = (one - two * (xx + yy)) * s;
+}
+
+template<typename F>
+void RotationScaleMatrix(const TransformStreams& t, const uint32_t i, F r[9]) {
+    RotationScaleMatrix(F::Load(t.qx + i), F::Load(t.qy + i), F::Load(t.qz + i), F::Load(t.qw + i), F::Load(t.scale + i), r);
+}
+
+template<typename F>
+void IntegrateBlock(float* qx, float* qy, float* qz, float* qw,
+                    const float* wx, const float* wy, const float* wz, const float dt, const uint32_t i) {
+    const F x = F::Load(qx + i), y = F::Load(qy + i), z = F::Load(qz + i), w = F::Load(qw + i);
+    const F h = F::Set(0.5f * dt);
+    const F ax = F::Load(wx + i) * h, ay = F::Load(wy + i) * h, az = F::Load(wz + i) * h;
+
+    const F nx = x + (ax * w + ay * z - az * y);
+    const F ny = y + (ay * w + az * x - ax * z);
+    const F nz = z + (ax * y - ay * x + az * w);
+    const F nw = w - (ax * x + ay * y + az * z);
+    const F invLength = F::Set(1.0f) / Sqrt(nx * nx + ny * ny + nz * nz + nw * nw);
+
+    (nx * invLength).Store(qx + i);
+    (ny * invLength).Store(qy + i);
+    (nz * invLength).Store(qz + i);
+    (nw * invLength).Store(qw + i);
+}
+
+template<typename F>
+void ComposeBlock(const TransformStreams& t, const uint32_t i, Mat4* out) {
+    F r[9];
+    RotationScaleMatrix(t, i, r);
+
+    const F zero = F::Set(0.0f);
+    const F columns[16] = {
+        r[0], r[1], r[2], zero,
+        r[3], r[4], r[5], zero,
+        r[6], r[7], r[8], zero,
+        F::Load(t.px + i), F::Load(t.py + i), F::Load(t.pz + i), F::Set(1.0f)
+    };
+    StoreMatrices(columns, out + i);
+}
+
+template<typename F>
+void ComposeInterpolatedBlock(const TransformStreams& a, const TransformStreams& b, const float alpha, const uint32_t i, Mat4* out) {
+    const F t = F::Set(alpha);
+    const auto Lerp = [&](const float* from, const float* to) {
+        const F start = F::Load(from + i);
+        return MulAdd(F::Load(to + i) - start, t, start);
+    };
+
+    const F x = Lerp(a.qx, b.qx), y = Lerp(a.qy, b.qy), z = Lerp(a.qz, b.qz), w = Lerp(a.qw, b.qw);
+    const F invLength = F::Set(1.0f) / Sqrt(x * x + y * y + z * z + w * w);
+
+    F r[9];
+    RotationScaleMatrix(x * invLength, y * invLength, z * invLength, w * invLength, F::Load(b.scale + i), r);
+
+    const F zero = F::Set(0.0f);
+    const F columns[16] = {
+        r[0], r[1], r[2], zero,
+        r[3], r[4], r[5], zero,
+        r[6], r[7], r[8], zero,
+        Lerp(a.px, b.px), Lerp(a.py, b.py), Lerp(a.pz, b.pz), F::Set(1.0f)
+    };
+    StoreMatrices(columns, out + i);
+}
+
+template<typename F>
+void SphereBlock(const TransformStreams& t, const SphereStreams& local, const SphereStreams& out, const uint32_t i) {
+    F r[9];
+    RotationScaleMatrix(t, i, r);
+
+    const F cx = F::Load(local.x + i), cy = F::Load(local.y + i), cz = F::Load(local.z + i);
+    MulAdd(r[0], cx, MulAdd(r[3], cy, MulAdd(r[6], cz, F::Load(t.px + i)))).Store(out.x + i);
+    MulAdd(r[1], cx, MulAdd(r[4], cy, MulAdd(r[7], cz, F::Load(t.py + i)))).Store(out.y + i);
+    MulAdd(r[2], cx, MulAdd(r[5], cy, MulAdd(r[8], cz, F::Load(t.pz + i)))).Store(out.z + i);
+    (F::Load(local.radius + i) * Abs(F::Load(t.scale + i))).Store(out.radius + i);
+}
+
+template<typename F>
+void AabbBlock(const TransformStreams& t, const AabbStreams& local, const AabbStreams& out, const uint32_t i) {
+    F r[9];
+    RotationScaleMatrix(t, i, r);
+
+    const F cx = F::Load(local.centerX + i), cy = F::Load(local.centerY + i), cz = F::Load(local.centerZ + i);
+    MulAdd(r[0], cx, MulAdd(r[3], cy, MulAdd(r[6], cz, F::Load(t.px + i)))).Store(out.centerX + i);
+    MulAdd(r[1], cx, MulAdd(r[4], cy, MulAdd(r[7], cz, F::Load(t.py + i)))).Store(out.centerY + i);
+    MulAdd(r[2], cx, MulAdd(r[5], cy, MulAdd(r[8], cz, F::Load(t.pz + i)))).Store(out.centerZ + i);
+
+    const F ex = F::Load(local.extentX + i), ey = F::Load(local.extentY + i), ez = F::Load(local.extentZ + i);
+    MulAdd(Abs(r[0]), ex, MulAdd(Abs(r[3]), ey, Abs(r[6]) * ez)).Store(out.extentX + i);
+    MulAdd(Abs(r[1]), ex, MulAdd(Abs(r[4]), ey, Abs(r[7]) * ez)).Store(out.extentY + i);
+    MulAdd(Abs(r[2]), ex, MulAdd(Abs(r[5]), ey, Abs(r[8]) * ez)).Store(out.extentZ + i);
+}
+
+template<typename F>
+uint32_t CullSphereBlock(const Frustum& frustum, const SphereStreams& spheres, const uint32_t i) {
+    const F x = F::Load(spheres.x + i), y = F::Load(spheres.y + i), z = F::Load(spheres.z + i);
+    const F negRadius = F::Set(0.0f) - F::Load(spheres.radius + i);
+
+    uint32_t culled = 0;
+    for (const Vec4& plane : frustum.planes) {
+        const F distance = MulAdd(F::Set(plane.x), x, MulAdd(F::Set(plane.y), y, MulAdd(F::Set(plane.z), z, F::Set(plane.w))));
+        culled |= LessThanMask(distance, negRadius);
+    }
+    return culled;
+}
+
+template<typename F>
+uint32_t CullAabbBlock(const Frustum& frustum, const AabbStreams& boxes, const uint32_t i) {
+    const F x = F::Load(boxes.centerX + i), y = F::Load(boxes.centerY + i), z = F::Load(boxes.centerZ + i);
+    const F ex = F::Load(boxes.extentX + i), ey = F::Load(boxes.extentY + i), ez = F::Load(boxes.extentZ + i);
+
+    uint32_t culled = 0;
+    for (const Vec4& plane : frustum.planes) {
+        const F distance = MulAdd(F::Set(plane.x), x, MulAdd(F::Set(plane.y), y, MulAdd(F::Set(plane.z), z, F::Set(plane.w))));
+        const F radius = MulAdd(F::Set(std::fabs(plane.x)), ex, MulAdd(F::Set(std::fabs(plane.y)), ey, F::Set(std::fabs(plane.z)) * ez));
+        culled |= LessThanMask(distance, F::Set(0.0f) - radius);
+    }
+    return culled;
+}
+
+}
+
+void IntegrateRotations(float* qx, float* qy, float* qz, float* qw,
+                        const float* wx, const float* wy, const float* wz, const float dt, const uint32_t count) {
+    RunWide(count, [&](auto tag, uint32_t i) { IntegrateBlock<decltype(tag)>(qx, qy, qz, qw, wx, wy, wz, dt, i); });
+}
+
+void IntegrateRotationsScalar(float* qx, float* qy, float* qz, float* qw,
+                              const float* wx, const float* wy, const float* wz, const float dt, const uint32_t count) {
+    RunScalar(count, [&](auto tag, uint32_t i) { IntegrateBlock<decltype(tag)>(qx, qy, qz, qw, wx, wy, wz, dt, i); });
+}
+
+void ComposeWorldMatrices(const TransformStreams& transforms, const uint32_t count, Mat4* out) {
+    RunWide(count, [&](auto tag, uint32_t i) { ComposeBlock<decltype(tag)>(transforms, i, out); });
+}
+
+void ComposeWorldMatricesScalar(const TransformStreams& transforms, const uint32_t count, Mat4* out) {
+    RunScalar(count, [&](auto tag, uint32_t i) { ComposeBlock<decltype(tag)>(transforms, i, out); });
+}
+
+void ComposeInterpolatedWorldMatrices(const TransformStreams& previous, const TransformStreams& current, const float alpha,
+                                      const uint32_t count, Mat4* out) {
+    RunWide(count, [&](auto tag, uint32_t i) { ComposeInterpolatedBlock<decltype(tag)>(previous, current, alpha, i, out); });
+}
+
+void ComposeInterpolatedWorldMatricesScalar(const TransformStreams& previous, const TransformStreams& current, const float alpha,
+                                            const uint32_t count, Mat4* out) {
+    RunScalar(count, [&](auto tag, uint32_t i) { ComposeInterpolatedBlock<decltype(tag)>(previous, current, alpha, i, out); });
+}
+
+void TransformSpheres(const TransformStreams& transforms, const SphereStreams& local, const uint32_t count, const SphereStreams& out) {
+    RunWide(count, [&](auto tag, uint32_t i) { SphereBlock<decltype(tag)>(transforms, local, out, i); });
+}
+
+void TransformSpheresScalar(const TransformStreams& transforms, const SphereStreams& local, const uint32_t count, const SphereStreams& out) {
+    RunScalar(count, [&](auto tag, uint32_t i) { SphereBlock<decltype(tag)>(transforms, local, out, i); });
+}
+
+void TransformAabbs(const TransformStreams& transforms, const AabbStreams& local, const uint32_t count, const AabbStreams& out) {
+    RunWide(count, [&](auto tag, uint32_t i) { AabbBlock<decltype(tag)>(transforms, local, out, i); });
+}
+
+void TransformAabbsScalar(const TransformStreams& transforms, const AabbStreams& local, const uint32_t count, const AabbStreams& out) {
+    RunScalar(count, [&](auto tag, uint32_t i) { AabbBlock<decltype(tag)>(transforms, local, out, i); });
+}
+
+uint32_t CullSpheres(const Frustum& frustum, const SphereStreams& spheres, const uint32_t count, const uint32_t baseIndex, uint32_t* visibleIndices) {
+    return RunCull(count, baseIndex, visibleIndices, true, [&](auto tag, uint32_t i) {
+        return CullSphereBlock<decltype(tag)>(frustum, spheres, i);
+    });
+}
+
+uint32_t CullSpheresScalar(const Frustum& frustum, const SphereStreams& spheres, const uint32_t count, const uint32_t baseIndex, uint32_t* visibleIndices) {
+    return RunCull(count, baseIndex, visibleIndices, false, [&](auto tag, uint32_t i) {
+        return CullSphereBlock<decltype(tag)>(frustum, spheres, i);
+    });
+}
+
+uint32_t CullAabbs(const Frustum& frustum, const AabbStreams& boxes, const uint32_t count, const uint32_t baseIndex, uint32_t* visibleIndices) {
+    return RunCull(count, baseIndex, visibleIndices, true, [&](auto tag, uint32_t i) {
+        return CullAabbBlock<decltype(tag)>(frustum, boxes, i);
+    });
+}
+
+uint32_t CullAabbsScalar(const Frustum& frustum, const AabbStreams& boxes, const uint32_t count, const uint32_t baseIndex, uint32_t* visibleIndices) {
+    return RunCull(count, baseIndex, visibleIndices, false, [&](auto tag, uint32_t i) {
+        return CullAabbBlock<decltype(tag)>(frustum, boxes, i);
+    });
+}
@@ -0,0 +1,72 @@
+#ifndef MATHKERNELS_H
+#define MATHKERNELS_H
+
+#include <cstdint>
+#include "mathlib.h"
+
+// Batched kernels over structure-of-arrays streams, processing MATH_SIMD_WIDTH
+// objects per iteration with a scalar tail. The *Scalar variants run the same
+// math one object at a time and are kept as the reference implementation.
+// Input streams may be the field streams of an ECS chunk directly.
+
+struct TransformStreams {
+    const float* px;
+    const float* py;
+    const float* pz;
+    const float* qx;
+    const float* qy;
+    const float* qz;
+    const float* qw;
+    const float* scale;
+};
+
+struct SphereStreams {
+    float* x;
+    float* y;
+    float* z;
+    float* radius;
+};
+
+struct AabbStreams {
+    float* centerX;
+    float* centerY;
+    float* centerZ;
+    float* extentX;
+    float* extentY;
+    float* extentZ;
+};
+
+// q' = normalize(q + 0.5 * dt * w * q)
+void IntegrateRotations(float* qx, float* qy, float* qz, float* qw,
+                        const float* wx, const float* wy, const float* wz, float dt, uint32_t count);
+void IntegrateRotationsScalar(float* qx, float* qy, float* qz, float* qw,
+                              const float* wx, const float* wy, const float* wz, float dt, uint32_t count);
+
+// Writes one column-major T * R * S matrix per object
+void ComposeWorldMatrices(const TransformStreams& transforms, uint32_t count, Mat4* out);
+void ComposeWorldMatricesScalar(const TransformStreams& transforms, uint32_t count, Mat4* out);
+
+// World matrices of the state between two ticks: positions are lerped and rotations
+// nlerped by alpha, scale comes from current. Consecutive rotations are assumed
+// to lie in the same hemisphere.
+void ComposeInterpolatedWorldMatrices(const TransformStreams& previous, const TransformStreams& current, float alpha,
+                                      uint32_t count, Mat4* out);
+void ComposeInterpolatedWorldMatricesScalar(const TransformStreams& previous, const TransformStreams& current, float alpha,
+                                            uint32_t count, Mat4* out);
+
+void TransformSpheres(const TransformStreams& transforms, const SphereStreams& local, uint32_t count, const SphereStreams& out);
+void TransformSpheresScalar(const TransformStreams& transforms, const SphereStreams& local, uint32_t count, const SphereStreams& out);
+
+// Conservative world space AABB of a rotated and scaled local box
+void TransformAabbs(const TransformStreams& transforms, const AabbStreams& local, uint32_t count, const AabbStreams& out);
+void TransformAabbsScalar(const TransformStreams& transforms, const AabbStreams& local, uint32_t count, const AabbStreams& out);
+
+// Writes the indices (offset by baseIndex) of objects intersecting the frustum
+// and returns how many were written. visibleIndices must hold `count` entries.
+uint32_t CullSpheres(const Frustum& frustum, const SphereStreams& spheres, uint32_t count, uint32_t baseIndex, uint32_t* visibleIndices);
+uint32_t CullSpheresScalar(const Frustum& frustum, const SphereStreams& spheres, uint32_t count, uint32_t baseIndex, uint32_t* visibleIndices);
+
+uint32_t CullAabbs(const Frustum& frustum, const AabbStreams& boxes, uint32_t count, uint32_t baseIndex, uint32_t* visibleIndices);
+uint32_t CullAabbsScalar(const Frustum& frustum, const AabbStreams& boxes, uint32_t count, uint32_t baseIndex, uint32_t* visibleIndices);
+
+#endif //MATHKERNELS_H
@@ -0,0 +1,154 @@
+#include "mathlib.h"
+
+const char* MathSimdName() {
+#if defined(MATH_SIMD_AVX2)
+    return "AVX2";
+#elif defined(MATH_SIMD_SSE)
+    return "SSE2";
+#elif defined(MATH_SIMD_NEON)
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+Mat4 Mat4Identity() {
+    Mat4 result = {};
+    result.m[0] = 1.0f;
+    result.m[5] = 1.0f;
+    result.m[10] = 1.0f;
+    result.m[15] = 1.0f;
+    return result;
+}
+
+Mat4 Mat4Mul(const Mat4& a, const Mat4& b) {
+    Mat4 result;
+
+    // Column j of the result is a's columns weighted by column j of b
+#if defined(MATH_SIMD_SSE)
+    const __m128 a0 = _mm_load_ps(&a.m[0]);
+    const __m128 a1 = _mm_load_ps(&a.m[4]);
+    const __m128 a2 = _mm_load_ps(&a.m[8]);
+    const __m128 a3 = _mm_load_ps(&a.m[12]);
+    for (int j = 0; j < 4; j++) {
+        __m128 column = _mm_mul_ps(a0, _mm_set1_ps(b.m[j * 4 + 0]));
+        column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(b.m[j * 4 + 1])));
+        column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(b.m[j * 4 + 2])));
+        column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(b.m[j * 4 + 3])));
+        _mm_store_ps(&result.m[j * 4], column);
+    }
+#elif defined(MATH_SIMD_NEON)
+    const float32x4_t a0 = vld1q_f32(&a.m[0]);
+    const float32x4_t a1 = vld1q_f32(&a.m[4]);
+    const float32x4_t a2 = vld1q_f32(&a.m[8]);
+    const float32x4_t a3 = vld1q_f32(&a.m[12]);
+    for (int j = 0; j < 4; j++) {
+        float32x4_t column = vmulq_n_f32(a0, b.m[j * 4 + 0]);
+        column = vmlaq_n_f32(column, a1, b.m[j * 4 + 1]);
+        column = vmlaq_n_f32(column, a2, b.m[j * 4 + 2]);
+        column = vmlaq_n_f32(column, a3, b.m[j * 4 + 3]);
+        vst1q_f32(&result.m[j * 4], column);
+    }
+#else
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 4; i++) {
+            result.m[j * 4 + i] = a.m[0 * 4 + i] * b.m[j * 4 + 0]
+                                + a.m[1 * 4 + i] * b.m[j * 4 + 1]
+                                + a.m[2 * 4 + i] * b.m[j * 4 + 2]
+                                + a.m[3 * 4 + i] * b.m[j * 4 + 3];
+        }
+    }
+#endif
+
+    return result;
+}
+
+Vec4 Mat4MulVec4(const Mat4& m, const Vec4 v) {
+    return {
+        m.m[0] * v.x + m.m[4] * v.y + m.m[8] * v.z + m.m[12] * v.w,
+        m.m[1] * v.x + m.m[5] * v.y + m.m[9] * v.z + m.m[13] * v.w,
+        m.m[2] * v.x + m.m[6] * v.y + m.m[10] * v.z + m.m[14] * v.w,
+        m.m[3] * v.x + m.m[7] * v.y + m.m[11] * v.z + m.m[15] * v.w
+    };
+}
+
+Mat4 Mat4FromTRS(const Vec3 translation, const Quat q, const float scale) {
+    const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    Mat4 result;
+    result.m[0] = (1.0f - 2.0f * (yy + zz)) * scale;
+    result.m[1] = 2.0f * (xy + wz) * scale;
+    result.m[2] = 2.0f * (xz - wy) * scale;
+    result.m[3] = 0.0f;
+    result.m[4] = 2.0f * (xy - wz) * scale;
+    result.m[5] = (1.0f - 2.0f * (xx + zz)) * scale;
+    result.m[6] = 2.0f * (yz + wx) * scale;
+    result.m[7] = 0.0f;
+    result.m[8] = 2.0f * (xz + wy) * scale;
+    result.m[9] = 2.0f * (yz - wx) * scale;
+    result.m[10] = (1.0f - 2.0f * (xx + yy)) * scale;
+    result.m[11] = 0.0f;
+    result.m[12] = translation.x;
+    result.m[13] = translation.y;
+    result.m[14] = translation.z;
+    result.m[15] = 1.0f;
+    return result;
+}
+
+Mat4 Mat4LookAt(const Vec3 eye, const Vec3 target, const Vec3 up) {
+    const Vec3 f = Normalize(target - eye);
+    const Vec3 s = Normalize(Cross(f, up));
+    const Vec3 u = Cross(s, f);
+
+    Mat4 result = Mat4Identity();
+    result.m[0] = s.x;
+    result.m[4] = s.y;
+    result.m[8] = s.z;
+    result.m[1] = u.x;
+    result.m[5] = u.y;
+    result.m[9] = u.z;
+    result.m[2] = -f.x;
+    result.m[6] = -f.y;
+    result.m[10] = -f.z;
+    result.m[12] = -Dot(s, eye);
+    result.m[13] = -Dot(u, eye);
+    result.m[14] = Dot(f, eye);
+    return result;
+}
+
+Mat4 Mat4Perspective(const float fovYRadians, const float aspect, const float nearPlane, const float farPlane) {
+    const float focal = 1.0f / std::tan(fovYRadians * 0.5f);
+
+    Mat4 result = {};
+    result.m[0] = focal / aspect;
+    result.m[5] = -focal;
+    result.m[10] = farPlane / (nearPlane - farPlane);
+    result.m[11] = -1.0f;
+    result.m[14] = (nearPlane * farPlane) / (nearPlane - farPlane);
+    return result;
+}
+
+Frustum FrustumFromViewProjection(const Mat4& vp) {
+    // Gribb/Hartmann plane extraction from the rows of the matrix, 0..1 clip depth
+    const Vec4 row0 = {vp.m[0], vp.m[4], vp.m[8], vp.m[12]};
+    const Vec4 row1 = {vp.m[1], vp.m[5], vp.m[9], vp.m[13]};
+    const Vec4 row2 = {vp.m[2], vp.m[6], vp.m[10], vp.m[14]};
+    const Vec4 row3 = {vp.m[3], vp.m[7], vp.m[11], vp.m[15]};
+
+    Frustum frustum;
+    frustum.planes[0] = {row3.x + row0.x, row3.y + row0.y, row3.z + row0.z, row3.w + row0.w}; // left
+    frustum.planes[1] = {row3.x - row0.x, row3.y - row0.y, row3.z - row0.z, row3.w - row0.w}; // right
+    frustum.planes[2] = {row3.x + row1.x, row3.y + row1.y, row3.z + row1.z, row3.w + row1.w}; // top (y down)
+    frustum.planes[3] = {row3.x - row1.x, row3.y - row1.y, row3.z - row1.z, row3.w - row1.w}; // bottom
+    frustum.planes[4] = row2;                                                                 // near
+    frustum.planes[5] = {row3.x - row2.x, row3.y - row2.y, row3.z - row2.z, row3.w - row2.w}; // far
+
+    for (Vec4& plane : frustum.planes) {
+        const float invLength = 1.0f / std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        plane = {plane.x * invLength, plane.y * invLength, plane.z * invLength, plane.w * invLength};
+    }
+
+    return frustum;
+}
@@ -0,0 +1,129 @@
+#ifndef MATHLIB_H
+#define MATHLIB_H
+
+#include <cmath>
+#include <cstdint>
+
+// Instruction set used by the math library, picked at compile time.
+// AVX2 needs ENGINE_ENABLE_AVX2 in CMake (or equivalent -mavx2 -mfma),
+// MATH_FORCE_SCALAR disables SIMD entirely.
+#if defined(MATH_FORCE_SCALAR)
+    #define MATH_SIMD_SCALAR 1
+#elif defined(__AVX2__) && defined(__FMA__)
+    #define MATH_SIMD_AVX2 1
+    #define MATH_SIMD_SSE 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #define MATH_SIMD_SSE 1
+    #include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define MATH_SIMD_NEON 1
+    #include <arm_neon.h>
+#else
+    #define MATH_SIMD_SCALAR 1
+#endif
+
+#if defined(MATH_SIMD_AVX2)
+    #define MATH_SIMD_WIDTH 8
+#elif defined(MATH_SIMD_SSE) || defined(MATH_SIMD_NEON)
+    #define MATH_SIMD_WIDTH 4
+#else
+    #define MATH_SIMD_WIDTH 1
+#endif
+
+const char* MathSimdName();
+
+struct Vec3 {
+    float x, y, z;
+};
+
+struct Vec4 {
+    float x, y, z, w;
+};
+
+struct Quat {
+    float x, y, z, w;
+};
+
+// Column-major, m[column * 4 + row], matching GLSL mat4 layout
+struct alignas(16) Mat4 {
+    float m[16];
+};
+
+// Planes are stored as (normal, distance) with normals pointing into the frustum
+struct Frustum {
+    Vec4 planes[6];
+};
+
+inline Vec3 operator+(const Vec3 a, const Vec3 b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline Vec3 operator-(const Vec3 a, const Vec3 b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline Vec3 operator*(const Vec3 a, const float s) { return {a.x * s, a.y * s, a.z * s}; }
+
+inline float Dot(const Vec3 a, const Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+inline Vec3 Cross(const Vec3 a, const Vec3 b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+inline float Length(const Vec3 v) { return std::sqrt(Dot(v, v)); }
+
+inline Vec3 Normalize(const Vec3 v) {
+    const float length = Length(v);
+    return length > 0.0f ? v * (1.0f / length) : v;
+}
+
+inline Vec3 Lerp(const Vec3 a, const Vec3 b, const float t) { return a + (b - a) * t; }
+
+inline Quat QuatIdentity() { return {0.0f, 0.0f, 0.0f, 1.0f}; }
+
+inline Quat QuatFromAxisAngle(const Vec3 axis, const float radians) {
+    const Vec3 n = Normalize(axis);
+    const float s = std::sin(radians * 0.5f);
+    return {n.x * s, n.y * s, n.z * s, std::cos(radians * 0.5f)};
+}
+
+inline Quat QuatMul(const Quat a, const Quat b) {
+    return {
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+    };
+}
+
+inline Quat QuatNormalize(const Quat q) {
+    const float invLength = 1.0f / std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    return {q.x * invLength, q.y * invLength, q.z * invLength, q.w * invLength};
+}
+
+inline Vec3 QuatRotate(const Quat q, const Vec3 v) {
+    // v + 2w(u x v) + 2u x (u x v)
+    const Vec3 u = {q.x, q.y, q.z};
+    const Vec3 t = Cross(u, v) * 2.0f;
+    return v + t * q.w + Cross(u, t);
+}
+
+// Normalised lerp along the shortest arc
+inline Quat QuatNlerp(const Quat a, Quat b, const float t) {
+    if (a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w < 0.0f) {
+        b = {-b.x, -b.y, -b.z, -b.w};
+    }
+    return QuatNormalize({
+        a.x + (b.x - a.x) * t,
+        a.y + (b.y - a.y) * t,
+        a.z + (b.z - a.z) * t,
+        a.w + (b.w - a.w) * t
+    });
+}
+
+Mat4 Mat4Identity();
+Mat4 Mat4Mul(const Mat4& a, const Mat4& b);
+Mat4 Mat4FromTRS(Vec3 translation, Quat rotation, float scale);
+Mat4 Mat4LookAt(Vec3 eye, Vec3 target, Vec3 up);
+// Right handed, Vulkan clip space: depth 0..1 and y pointing down
+Mat4 Mat4Perspective(float fovYRadians, float aspect, float nearPlane, float farPlane);
+Vec4 Mat4MulVec4(const Mat4& m, Vec4 v);
+
+Frustum FrustumFromViewProjection(const Mat4& viewProjection);
+
+#endif //MATHLIB_H
@@ -0,0 +1,187 @@
+#include "memory.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "SDL3/SDL_log.h"
+#include "SDL3/SDL_stdinc.h"
+
+constexpr size_t SCRATCH_ARENA_SIZE = 1024 * 1024;
+
+static std::atomic<uint64_t> heapAllocations{0};
+static std::atomic<uint64_t> heapFrees{0};
+static std::atomic<uint64_t> heapBytes{0};
+
+static void CountAllocation(size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    heapBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void CountFree() {
+    heapFrees.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool CreateArena(LinearArena* arena, size_t capacity) {
+    arena->base = (uint8_t*) malloc(capacity);
+    arena->capacity = arena->base ? capacity : 0;
+    arena->offset = 0;
+    arena->highWater = 0;
+    if (!arena->base) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to reserve %zu byte arena", capacity);
+        return false;
+    }
+    return true;
+}
+
+void DestroyArena(LinearArena* arena) {
+    free(arena->base);
+    arena->base = nullptr;
+    arena->capacity = 0;
+    arena->offset = 0;
+}
+
+void* ArenaAlloc(LinearArena* arena, size_t size, size_t alignment) {
+    const uintptr_t start = (uintptr_t) arena->base + arena->offset;
+    const uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t) (alignment - 1);
+    const size_t end = (size_t) (aligned - (uintptr_t) arena->base) + size;
+    if (end > arena->capacity) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Arena out of memory: %zu of %zu bytes requested", end, arena->capacity);
+        return nullptr;
+    }
+
+    arena->offset = end;
+    if (end > arena->highWater) {
+        arena->highWater = end;
+    }
+    return (void*) aligned;
+}
+
+void ResetArena(LinearArena* arena) {
+    arena->offset = 0;
+}
+
+LinearArena* ScratchArena() {
+    static LinearArena scratch = [] {
+        LinearArena arena;
+        CreateArena(&arena, SCRATCH_ARENA_SIZE);
+        return arena;
+    }();
+    return &scratch;
+}
+
+// SDL allocations go through these so SDL_malloc and SDL_aligned_alloc are counted too
+static SDL_malloc_func originalMalloc;
+static SDL_calloc_func originalCalloc;
+static SDL_realloc_func originalRealloc;
+static SDL_free_func originalFree;
+
+static void* SDLCALL CountingMalloc(size_t size) {
+    CountAllocation(size);
+    return originalMalloc(size);
+}
+
+static void* SDLCALL CountingCalloc(size_t count, size_t size) {
+    CountAllocation(count * size);
+    return originalCalloc(count, size);
+}
+
+static void* SDLCALL CountingRealloc(void* memory, size_t size) {
+    CountAllocation(size);
+    return originalRealloc(memory, size);
+}
+
+static void SDLCALL CountingFree(void* memory) {
+    if (memory) {
+        CountFree();
+    }
+    originalFree(memory);
+}
+
+bool InstallMemoryHooks() {
+    SDL_GetOriginalMemoryFunctions(&originalMalloc, &originalCalloc, &originalRealloc, &originalFree);
+    if (!SDL_SetMemoryFunctions(CountingMalloc, CountingCalloc, CountingRealloc, CountingFree)) {
+        SDL_Log("Set Memory Functions Failed: %s", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+HeapCounters GetHeapCounters() {
+    return HeapCounters{
+        .allocations = heapAllocations.load(std::memory_order_relaxed),
+        .frees = heapFrees.load(std::memory_order_relaxed),
+        .bytesAllocated = heapBytes.load(std::memory_order_relaxed)
+    };
+}
+
+// Global new/delete replacements so every C++ container allocation is counted
+
+static void* AllocateCounted(size_t size) {
+    CountAllocation(size);
+    return malloc(size ? size : 1);
+}
+
+static void* AllocateCountedAligned(size_t size, size_t alignment) {
+    CountAllocation(size);
+#ifdef _MSC_VER
+    return _aligned_malloc(size ? size : 1, alignment);
+#else
+    void* memory = nullptr;
+    return posix_memalign(&memory, alignment, size ? size : 1) == 0 ? memory : nullptr;
+#endif
+}
+
+static void FreeCounted(void* memory) {
+    if (memory) {
+        CountFree();
+        free(memory);
+    }
+}
+
+static void FreeCountedAligned(void* memory) {
+    if (memory) {
+        CountFree();
+#ifdef _MSC_VER
+        _aligned_free(memory);
+#else
+        free(memory);
+#endif
+    }
+}
+
+void* operator new(size_t size) {
+    void* memory = AllocateCounted(size);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size) {
+    void* memory = AllocateCounted(size);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return AllocateCounted(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return AllocateCounted(size); }
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    void* memory = AllocateCountedAligned(size, (size_t) alignment);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    void* memory = AllocateCountedAligned(size, (size_t) alignment);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept { FreeCounted(memory); }
+void operator delete[](void* memory) noexcept { FreeCounted(memory); }
+void operator delete(void* memory, size_t) noexcept { FreeCounted(memory); }
+void operator delete[](void* memory, size_t) noexcept { FreeCounted(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { FreeCounted(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { FreeCounted(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { FreeCountedAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { FreeCountedAligned(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { FreeCountedAligned(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { FreeCountedAligned(memory); }
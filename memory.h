@@ -0,0 +1,61 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Linear (bump) allocator over one fixed block. Allocations are never freed
+// individually, the whole arena is reset at once.
+struct LinearArena {
+    uint8_t* base;
+    size_t capacity;
+    size_t offset;
+    size_t highWater; // largest offset seen since creation
+};
+
+bool CreateArena(LinearArena* arena, size_t capacity);
+void DestroyArena(LinearArena* arena);
+// Returns nullptr and logs when the arena is exhausted
+void* ArenaAlloc(LinearArena* arena, size_t size, size_t alignment = 16);
+void ResetArena(LinearArena* arena);
+
+template<typename T>
+T* ArenaAllocArray(LinearArena* arena, size_t count) {
+    return (T*) ArenaAlloc(arena, sizeof(T) * count, alignof(T) > 16 ? alignof(T) : 16);
+}
+
+// Temporary allocations from an arena that are all released when the scope
+// ends. Scopes nest, an inner scope must end before the outer one.
+class ScratchScope {
+public:
+    explicit ScratchScope(LinearArena* arena) : arena(arena), mark(arena->offset) {}
+    ~ScratchScope() { arena->offset = mark; }
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    void* Alloc(size_t size, size_t alignment = 16) { return ArenaAlloc(arena, size, alignment); }
+
+    template<typename T>
+    T* AllocArray(size_t count) { return ArenaAllocArray<T>(arena, count); }
+
+private:
+    LinearArena* arena;
+    size_t mark;
+};
+
+// Process wide scratch arena for init time and other single threaded temporaries
+LinearArena* ScratchArena();
+
+// Heap allocation counters, fed by the global operator new/delete replacements
+// and the SDL memory function hooks installed by InstallMemoryHooks.
+struct HeapCounters {
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t bytesAllocated;
+};
+
+bool InstallMemoryHooks();
+HeapCounters GetHeapCounters();
+
+#endif //MEMORY_H
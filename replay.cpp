@@ -0,0 +1,899 @@
+// Headless replay of a frame capture through the engine's Vulkan renderer.
+// Replays every captured frame against an offscreen target, measures the CPU
+// time to update and record each frame, the GPU time of the culling and draw
+// passes from timestamp queries and the heap allocations per frame, then
+// compares the medians with a stored baseline.
+//
+//   FrameReplay capture.bin [--iterations N] [--baseline file] [--write-baseline file]
+//               [--baseline-dir dir] [--write-baseline-dir dir] [--tolerance 0.15]
+//
+// With --baseline-dir the baseline is picked per device: <dir>/<device>.baseline
+// when one was measured on this GPU with --write-baseline-dir, <dir>/default.baseline
+// otherwise.
+//
+// Exits with 0 when every metric is within tolerance, 1 on a regression, 2 when
+// the capture cannot be replayed and 77 when there is no usable Vulkan device.
+// Run it from the build output directory so the shaders beside GameEngine are found.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "SDL3/SDL_cpuinfo.h"
+#include "SDL3/SDL_log.h"
+#include "SDL3/SDL_timer.h"
+#include "framecapture.h"
+#include "gpudriven.h"
+#include "jobs.h"
+#include "memory.h"
+
+constexpr size_t FRAME_ARENA_SIZE = 4 * 1024 * 1024;
+constexpr uint32_t TIMESTAMP_COUNT = 3;     // frame start, after culling, after the render pass
+constexpr double ABSOLUTE_SLACK_MS = 0.05;  // keeps sub-0.1 ms timings from failing on noise
+
+constexpr int EXIT_PASS = 0;
+constexpr int EXIT_REGRESSION = 1;
+constexpr int EXIT_ERROR = 2;
+constexpr int EXIT_NO_DEVICE = 77; // the usual "skipped" code, see SKIP_RETURN_CODE in CMakeLists.txt
+
+struct ReplayMetrics {
+    double cpuMs;
+    double gpuCullMs;
+    double gpuDrawMs;
+    double allocations; // heap allocations per frame
+};
+
+struct ReplayOptions {
+    const char* capturePath;
+    const char* baselinePath;
+    const char* writeBaselinePath;
+    const char* baselineDir;
+    const char* writeBaselineDir;
+    uint32_t iterations;
+    double tolerance;
+};
+
+// Offscreen stand-in for the swapchain, everything else is the regular VulkanContext
+struct ReplayDevice {
+    VulkanContext context;
+    VkImage colorImage;
+    VkDeviceMemory colorMemory;
+    VkImageView colorImageView;
+    VkFramebuffer framebuffer;
+    VkCommandBuffer commandBuffer;
+    VkFence fence;
+    VkQueryPool queryPool;
+    double timestampPeriodMs; // 0 when the queue has no timestamps
+};
+
+struct CaptureInfo {
+    uint32_t maxInstances;
+    uint32_t frameCount;
+    VkExtent2D maxExtent;
+};
+
+static bool ParseOptions(int argc, char* argv[], ReplayOptions* options) {
+    *options = {nullptr, nullptr, nullptr, nullptr, nullptr, 10, 0.15};
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--iterations") == 0 && hasValue) {
+            options->iterations = (uint32_t) strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && hasValue) {
+            options->baselinePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--write-baseline") == 0 && hasValue) {
+            options->writeBaselinePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--baseline-dir") == 0 && hasValue) {
+            options->baselineDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--write-baseline-dir") == 0 && hasValue) {
+            options->writeBaselineDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0 && hasValue) {
+            options->tolerance = strtod(argv[++i], nullptr);
+        }
+        else if (argv[i][0] != '-' && !options->capturePath) {
+            options->capturePath = argv[i];
+        }
+        else {
+            return false;
+        }
+    }
+    return options->capturePath && options->iterations > 0;
+}
+
+static const char* CaptureCommandName(CaptureCommand command) {
+    switch (command) {
+        case CaptureCommand::SceneSetup: return "SceneSetup";
+        case CaptureCommand::BeginFrame: return "BeginFrame";
+        case CaptureCommand::UpdateInstances: return "UpdateInstances";
+        case CaptureCommand::Cull: return "Cull";
+        case CaptureCommand::BeginRenderPass: return "BeginRenderPass";
+        case CaptureCommand::DrawScene: return "DrawScene";
+        case CaptureCommand::EndRenderPass: return "EndRenderPass";
+        case CaptureCommand::EndFrame: return "EndFrame";
+        default: return "unknown";
+    }
+}
+
+// Checks that the stream is well formed, so ReplayCapture can trust it, and finds
+// the scene size and the largest frame so the targets are created once. A single
+// SceneSetup comes first, every BeginFrame has its EndFrame, and DrawScene only
+// appears between BeginRenderPass and EndRenderPass inside a frame. The number of
+// complete frames must match the file header, so a capture cut at a frame boundary is rejected.
+static bool ScanCapture(CaptureReader reader, const CaptureFileHeader& fileHeader, CaptureInfo* info) {
+    enum class ScanState {
+        BeforeSetup,
+        BetweenFrames,
+        InFrame,
+        InRenderPass
+    };
+
+    *info = {};
+    ScanState state = ScanState::BeforeSetup;
+    uint32_t commandIndex = 0;
+    CaptureCommandHeader header;
+    const uint8_t* payload;
+    for (; NextCaptureCommand(&reader, &header, &payload); commandIndex++) {
+        bool valid = false;
+        switch (header.command) {
+            case CaptureCommand::SceneSetup:
+                if (state == ScanState::BeforeSetup && header.size == sizeof(SceneSetupCommand)) {
+                    SceneSetupCommand setup;
+                    memcpy(&setup, payload, sizeof(setup));
+                    info->maxInstances = setup.maxInstances;
+                    state = ScanState::BetweenFrames;
+                    valid = setup.maxInstances > 0;
+                }
+                break;
+
+            case CaptureCommand::BeginFrame:
+                if (state == ScanState::BetweenFrames && header.size == sizeof(BeginFrameCommand)) {
+                    BeginFrameCommand frame;
+                    memcpy(&frame, payload, sizeof(frame));
+                    info->maxExtent.width = SDL_max(info->maxExtent.width, frame.width);
+                    info->maxExtent.height = SDL_max(info->maxExtent.height, frame.height);
+                    state = ScanState::InFrame;
+                    valid = frame.width > 0 && frame.height > 0;
+                }
+                break;
+
+            case CaptureCommand::UpdateInstances:
+                if (state == ScanState::InFrame) {
+                    UpdateInstancesCommand instances;
+                    SimSnapshot snapshot;
+                    valid = CaptureInstancesSnapshot(payload, header.size, &instances, &snapshot)
+                            && instances.instanceCount <= info->maxInstances;
+                }
+                break;
+
+            case CaptureCommand::Cull:
+                valid = state == ScanState::InFrame && header.size == 0;
+                break;
+
+            case CaptureCommand::BeginRenderPass:
+                valid = state == ScanState::InFrame && header.size == sizeof(BeginRenderPassCommand);
+                state = ScanState::InRenderPass;
+                break;
+
+            case CaptureCommand::DrawScene:
+                valid = state == ScanState::InRenderPass && header.size == 0;
+                break;
+
+            case CaptureCommand::EndRenderPass:
+                valid = state == ScanState::InRenderPass && header.size == 0;
+                state = ScanState::InFrame;
+                break;
+
+            case CaptureCommand::EndFrame:
+                valid = state == ScanState::InFrame && header.size == 0;
+                state = ScanState::BetweenFrames;
+                info->frameCount++;
+                break;
+
+            default:
+                break;
+        }
+        if (!valid) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Capture command %u (%s, %u bytes) is out of place or malformed",
+                         commandIndex, CaptureCommandName(header.command), header.size);
+            return false;
+        }
+    }
+
+    if (reader.truncated) {
+        return false;
+    }
+    if (state != ScanState::BetweenFrames || info->frameCount == 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Capture has no scene setup, no frames or ends inside a frame");
+        return false;
+    }
+    if (info->frameCount != fileHeader.frameCount) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Capture holds %u frames but its header promises %u",
+                     info->frameCount, fileHeader.frameCount);
+        return false;
+    }
+    return true;
+}
+
+static bool CreateAttachment(VulkanContext* vk, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                             VkImage* image, VkDeviceMemory* memory, VkImageView* view) {
+    VkImageCreateInfo imageInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = {vk->extent.width, vk->extent.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+    if (vkCreateImage(vk->device, &imageInfo, nullptr, image) != VK_SUCCESS) {
+        SDL_Log("Create Attachment Image Failed");
+        return false;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(vk->device, *image, &requirements);
+    VkMemoryAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = FindMemoryType(vk, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+    if (TrackedAllocateMemory(vk->memoryTracker, vk->device, &allocateInfo, GpuMemoryCategory::Attachment, memory) != VK_SUCCESS) {
+        SDL_Log("Allocate Attachment Memory Failed");
+        return false;
+    }
+    vkBindImageMemory(vk->device, *image, *memory, 0);
+
+    VkImageViewCreateInfo viewInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = *image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .subresourceRange = {
+            .aspectMask = aspect,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    if (vkCreateImageView(vk->device, &viewInfo, nullptr, view) != VK_SUCCESS) {
+        SDL_Log("Create Attachment View Failed");
+        return false;
+    }
+    return true;
+}
+
+// Same attachments and dependency as the swapchain pass, but the color target stays an attachment
+static bool CreateOffscreenRenderPass(VulkanContext* vk) {
+    VkAttachmentDescription attachments[2] = {
+        {
+            .format = vk->surfaceFormat.format,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+        },
+        {
+            .format = vk->depthFormat,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+        }
+    };
+
+    VkAttachmentReference colorAttachmentRef = {
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    };
+    VkAttachmentReference depthAttachmentRef = {
+        .attachment = 1,
+        .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+    };
+    VkSubpassDescription subpass = {
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachmentRef,
+        .pDepthStencilAttachment = &depthAttachmentRef
+    };
+    VkSubpassDependency dependency = {
+        .srcSubpass = VK_SUBPASS_EXTERNAL,
+        .dstSubpass = 0,
+        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+    };
+
+    VkRenderPassCreateInfo renderPassInfo = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = 2,
+        .pAttachments = attachments,
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+        .dependencyCount = 1,
+        .pDependencies = &dependency
+    };
+    if (vkCreateRenderPass(vk->device, &renderPassInfo, nullptr, &vk->renderPass) != VK_SUCCESS) {
+        SDL_Log("Create Render Pass Failed");
+        return false;
+    }
+    return true;
+}
+
+// Instance and physical device, false when this machine has no usable Vulkan device
+static bool FindReplayDevice(ReplayDevice* replay) {
+    VulkanContext* vk = &replay->context;
+    ScratchScope scratch(ScratchArena());
+
+    VkApplicationInfo appInfo = {
+        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        .pApplicationName = "FrameReplay",
+        .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+        .pEngineName = "No Engine",
+        .engineVersion = VK_MAKE_VERSION(1, 0, 0),
+        .apiVersion = VK_API_VERSION_1_2
+    };
+    VkInstanceCreateInfo instanceCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        .pApplicationInfo = &appInfo
+    };
+#ifdef __APPLE__
+    static const char* instanceExtensions[] = {
+        VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME
+    };
+    instanceCreateInfo.flags |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
+    instanceCreateInfo.enabledExtensionCount = 2;
+    instanceCreateInfo.ppEnabledExtensionNames = instanceExtensions;
+#endif
+    if (vkCreateInstance(&instanceCreateInfo, nullptr, &vk->instance) != VK_SUCCESS) {
+        SDL_Log("Create Instance Failed");
+        return false;
+    }
+
+    // Prefer a discrete GPU, otherwise the first device with a graphics queue
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(vk->instance, &deviceCount, nullptr);
+    VkPhysicalDevice* physicalDevices = scratch.AllocArray<VkPhysicalDevice>(deviceCount);
+    if (!physicalDevices) {
+        return false;
+    }
+    vkEnumeratePhysicalDevices(vk->instance, &deviceCount, physicalDevices);
+
+    bool found = false;
+    for (uint32_t i = 0; i < deviceCount; i++) {
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevices[i], &familyCount, nullptr);
+        VkQueueFamilyProperties* families = scratch.AllocArray<VkQueueFamilyProperties>(familyCount);
+        if (!families) {
+            continue;
+        }
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevices[i], &familyCount, families);
+
+        for (uint32_t f = 0; f < familyCount; f++) {
+            if (!(families[f].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+                continue;
+            }
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(physicalDevices[i], &properties);
+            if (!found || properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
+                vk->physicalDevice = physicalDevices[i];
+                vk->physicalDeviceProperties = properties;
+                vk->graphicsFamily = f;
+                replay->timestampPeriodMs = families[f].timestampValidBits > 0
+                    ? (double) properties.limits.timestampPeriod / 1e6 : 0.0;
+                found = true;
+            }
+            break;
+        }
+    }
+    if (!found) {
+        SDL_Log("No Vulkan device with a graphics queue");
+        return false;
+    }
+    vk->presentFamily = vk->graphicsFamily;
+    vkGetPhysicalDeviceMemoryProperties(vk->physicalDevice, &vk->memoryProperties);
+    SDL_Log("Replaying on %s", vk->physicalDeviceProperties.deviceName);
+    return true;
+}
+
+// Logical device without a surface, with the features CreateGpuScene expects
+static bool CreateReplayDevice(ReplayDevice* replay, VkExtent2D extent) {
+    VulkanContext* vk = &replay->context;
+
+    VkPhysicalDeviceVulkan12Features supported12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES
+    };
+    VkPhysicalDeviceFeatures2 supportedFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = vk->physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_2 ? &supported12 : nullptr
+    };
+    vkGetPhysicalDeviceFeatures2(vk->physicalDevice, &supportedFeatures);
+    vk->supportsDrawIndirectCount = supported12.drawIndirectCount && supportedFeatures.features.multiDrawIndirect;
+    vk->supportsDrawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+
+    VkPhysicalDeviceVulkan12Features enabled12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .drawIndirectCount = vk->supportsDrawIndirectCount
+    };
+    VkPhysicalDeviceFeatures2 deviceFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = supportedFeatures.pNext ? &enabled12 : nullptr
+    };
+    deviceFeatures.features.multiDrawIndirect = supportedFeatures.features.multiDrawIndirect;
+    deviceFeatures.features.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+
+    float queuePriority = 1.0f;
+    VkDeviceQueueCreateInfo queueCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+        .queueFamilyIndex = vk->graphicsFamily,
+        .queueCount = 1,
+        .pQueuePriorities = &queuePriority
+    };
+#ifdef __APPLE__
+    static const char* deviceExtensions[] = {"VK_KHR_portability_subset"};
+    const uint32_t deviceExtensionCount = 1;
+#else
+    static const char* const* deviceExtensions = nullptr;
+    const uint32_t deviceExtensionCount = 0;
+#endif
+    VkDeviceCreateInfo deviceCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = &deviceFeatures,
+        .queueCreateInfoCount = 1,
+        .pQueueCreateInfos = &queueCreateInfo,
+        .enabledExtensionCount = deviceExtensionCount,
+        .ppEnabledExtensionNames = deviceExtensions,
+        .pEnabledFeatures = nullptr
+    };
+    if (vkCreateDevice(vk->physicalDevice, &deviceCreateInfo, nullptr, &vk->device) != VK_SUCCESS) {
+        SDL_Log("CREATE DEVICE FAILED");
+        return false;
+    }
+    vkGetDeviceQueue(vk->device, vk->graphicsFamily, 0, &vk->graphicsQueue);
+    vk->presentQueue = vk->graphicsQueue;
+
+    // Attribution only, the budget is not polled during a replay
+    vk->memoryTracker = new GpuMemoryTracker();
+    InitGpuMemoryTracker(vk->memoryTracker, vk->physicalDevice, false);
+    vk->memoryTracker->reportInterval = 0;
+
+    VkCommandPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = vk->graphicsFamily
+    };
+    if (vkCreateCommandPool(vk->device, &poolInfo, nullptr, &vk->commandPool) != VK_SUCCESS) {
+        SDL_Log("Create Command Pool Failed");
+        return false;
+    }
+    VkCommandBufferAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = vk->commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1
+    };
+    VkFenceCreateInfo fenceInfo = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO
+    };
+    if (vkAllocateCommandBuffers(vk->device, &allocateInfo, &replay->commandBuffer) != VK_SUCCESS
+        || vkCreateFence(vk->device, &fenceInfo, nullptr, &replay->fence) != VK_SUCCESS) {
+        SDL_Log("Create Frame Resources Failed");
+        return false;
+    }
+
+    if (replay->timestampPeriodMs > 0.0) {
+        VkQueryPoolCreateInfo queryInfo = {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = TIMESTAMP_COUNT
+        };
+        if (vkCreateQueryPool(vk->device, &queryInfo, nullptr, &replay->queryPool) != VK_SUCCESS) {
+            SDL_Log("Create Query Pool Failed");
+            return false;
+        }
+    }
+    else {
+        SDL_Log("Graphics queue has no timestamps, GPU times will read 0");
+    }
+
+    // Offscreen targets at the largest captured size, smaller frames render into a corner
+    vk->extent = extent;
+    vk->surfaceFormat = {VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+    vk->depthFormat = VK_FORMAT_D32_SFLOAT;
+    if (!CreateOffscreenRenderPass(vk)
+        || !CreateAttachment(vk, vk->surfaceFormat.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+                             &replay->colorImage, &replay->colorMemory, &replay->colorImageView)
+        || !CreateAttachment(vk, vk->depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT,
+                             &vk->depthImage, &vk->depthMemory, &vk->depthImageView)) {
+        return false;
+    }
+
+    VkImageView attachments[2] = {replay->colorImageView, vk->depthImageView};
+    VkFramebufferCreateInfo framebufferInfo = {
+        .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+        .renderPass = vk->renderPass,
+        .attachmentCount = 2,
+        .pAttachments = attachments,
+        .width = extent.width,
+        .height = extent.height,
+        .layers = 1
+    };
+    if (vkCreateFramebuffer(vk->device, &framebufferInfo, nullptr, &replay->framebuffer) != VK_SUCCESS) {
+        SDL_Log("Create Framebuffer Failed");
+        return false;
+    }
+    return true;
+}
+
+// Safe on a partially created device, null handles are skipped by the destroy calls
+static void DestroyReplayDevice(ReplayDevice* replay) {
+    VulkanContext* vk = &replay->context;
+    if (vk->device) {
+        vkDeviceWaitIdle(vk->device);
+        vkDestroyFramebuffer(vk->device, replay->framebuffer, nullptr);
+        vkDestroyImageView(vk->device, replay->colorImageView, nullptr);
+        vkDestroyImage(vk->device, replay->colorImage, nullptr);
+        TrackedFreeMemory(vk->memoryTracker, vk->device, replay->colorMemory);
+        vkDestroyImageView(vk->device, vk->depthImageView, nullptr);
+        vkDestroyImage(vk->device, vk->depthImage, nullptr);
+        TrackedFreeMemory(vk->memoryTracker, vk->device, vk->depthMemory);
+        vkDestroyRenderPass(vk->device, vk->renderPass, nullptr);
+        vkDestroyQueryPool(vk->device, replay->queryPool, nullptr);
+        vkDestroyFence(vk->device, replay->fence, nullptr);
+        vkDestroyCommandPool(vk->device, vk->commandPool, nullptr);
+        vkDestroyDevice(vk->device, nullptr);
+    }
+    delete vk->memoryTracker;
+    if (vk->instance) {
+        vkDestroyInstance(vk->instance, nullptr);
+    }
+}
+
+// Executes every command in the capture once, appending one entry per frame
+static bool ReplayCapture(ReplayDevice* replay, GpuScene* gpu, CaptureReader reader, JobSystem& jobs,
+                          LinearArena* frameArena, std::vector<ReplayMetrics>& frames) {
+    VulkanContext* vk = &replay->context;
+    const VkCommandBuffer commandBuffer = replay->commandBuffer;
+    const bool timestamps = replay->queryPool != VK_NULL_HANDLE;
+
+    Uint64 frameStartNS = 0;
+    HeapCounters heapAtStart = {};
+    CaptureCommandHeader header;
+    const uint8_t* payload;
+    while (NextCaptureCommand(&reader, &header, &payload)) {
+        switch (header.command) {
+            case CaptureCommand::SceneSetup:
+                break; // the scene was created from the scan
+
+            case CaptureCommand::BeginFrame: {
+                BeginFrameCommand frame;
+                if (header.size != sizeof(frame)) {
+                    return false;
+                }
+                memcpy(&frame, payload, sizeof(frame));
+                heapAtStart = GetHeapCounters();
+                frameStartNS = SDL_GetTicksNS();
+                ResetArena(frameArena);
+                vk->extent = {frame.width, frame.height};
+
+                VkCommandBufferBeginInfo beginInfo = {
+                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+                };
+                vkResetCommandBuffer(commandBuffer, 0);
+                if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+                    return false;
+                }
+                if (timestamps) {
+                    vkCmdResetQueryPool(commandBuffer, replay->queryPool, 0, TIMESTAMP_COUNT);
+                    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, replay->queryPool, 0);
+                }
+                break;
+            }
+
+            case CaptureCommand::UpdateInstances: {
+                UpdateInstancesCommand instances;
+                SimSnapshot snapshot;
+                if (!CaptureInstancesSnapshot(payload, header.size, &instances, &snapshot)) {
+                    return false;
+                }
+                if (!UpdateGpuInstances(gpu, &snapshot, instances.alpha, instances.camera, instances.aspect, 0, jobs, frameArena)) {
+                    return false;
+                }
+                break;
+            }
+
+            case CaptureCommand::Cull:
+                RecordGpuCulling(gpu, commandBuffer, 0);
+                if (timestamps) {
+                    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, replay->queryPool, 1);
+                }
+                break;
+
+            case CaptureCommand::BeginRenderPass: {
+                BeginRenderPassCommand pass;
+                if (header.size != sizeof(pass)) {
+                    return false;
+                }
+                memcpy(&pass, payload, sizeof(pass));
+
+                VkClearValue clearValues[2];
+                clearValues[0].color = {{pass.clearColor[0], pass.clearColor[1], pass.clearColor[2], pass.clearColor[3]}};
+                clearValues[1].depthStencil = {1.0f, 0};
+                VkRenderPassBeginInfo renderPassInfo = {
+                    .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+                    .renderPass = vk->renderPass,
+                    .framebuffer = replay->framebuffer,
+                    .renderArea = {{0, 0}, vk->extent},
+                    .clearValueCount = 2,
+                    .pClearValues = clearValues
+                };
+                vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+                break;
+            }
+
+            case CaptureCommand::DrawScene:
+                RecordGpuDraw(gpu, vk, commandBuffer, 0);
+                break;
+
+            case CaptureCommand::EndRenderPass:
+                vkCmdEndRenderPass(commandBuffer);
+                if (timestamps) {
+                    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, replay->queryPool, 2);
+                }
+                break;
+
+            case CaptureCommand::EndFrame: {
+                if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+                    return false;
+                }
+                VkSubmitInfo submitInfo = {
+                    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                    .commandBufferCount = 1,
+                    .pCommandBuffers = &commandBuffer
+                };
+                if (vkQueueSubmit(vk->graphicsQueue, 1, &submitInfo, replay->fence) != VK_SUCCESS) {
+                    SDL_Log("Queue Submit Failed");
+                    return false;
+                }
+
+                ReplayMetrics metrics = {};
+                metrics.cpuMs = (double) (SDL_GetTicksNS() - frameStartNS) / 1e6;
+                metrics.allocations = (double) (GetHeapCounters().allocations - heapAtStart.allocations);
+
+                // Frames run one at a time so the timings are not smeared across each other
+                vkWaitForFences(vk->device, 1, &replay->fence, VK_TRUE, UINT64_MAX);
+                vkResetFences(vk->device, 1, &replay->fence);
+                if (timestamps) {
+                    uint64_t ticks[TIMESTAMP_COUNT];
+                    vkGetQueryPoolResults(vk->device, replay->queryPool, 0, TIMESTAMP_COUNT, sizeof(ticks), ticks,
+                                          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+                    metrics.gpuCullMs = (double) (ticks[1] - ticks[0]) * replay->timestampPeriodMs;
+                    metrics.gpuDrawMs = (double) (ticks[2] - ticks[1]) * replay->timestampPeriodMs;
+                }
+                frames.push_back(metrics);
+                break;
+            }
+
+            default:
+                SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Unknown capture command %u", (uint32_t) header.command);
+                return false;
+        }
+    }
+    return !reader.truncated;
+}
+
+static double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+}
+
+static ReplayMetrics Summarise(const std::vector<ReplayMetrics>& frames) {
+    std::vector<double> cpu, cull, draw, allocations;
+    for (const ReplayMetrics& frame : frames) {
+        cpu.push_back(frame.cpuMs);
+        cull.push_back(frame.gpuCullMs);
+        draw.push_back(frame.gpuDrawMs);
+        allocations.push_back(frame.allocations);
+    }
+    // Allocations are not noise, any frame that touches the heap counts
+    return {Median(cpu), Median(cull), Median(draw), *std::max_element(allocations.begin(), allocations.end())};
+}
+
+static bool WriteBaseline(const char* path, const ReplayMetrics& metrics) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to open %s for the baseline", path);
+        return false;
+    }
+    fprintf(file, "cpu_ms %.4f\ngpu_cull_ms %.4f\ngpu_draw_ms %.4f\nallocations %.0f\n",
+            metrics.cpuMs, metrics.gpuCullMs, metrics.gpuDrawMs, metrics.allocations);
+    return fclose(file) == 0;
+}
+
+static bool ReadBaseline(const char* path, ReplayMetrics* metrics) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to open baseline %s", path);
+        return false;
+    }
+
+    *metrics = {};
+    uint32_t found = 0;
+    char key[32];
+    double value;
+    while (fscanf(file, "%31s %lf", key, &value) == 2) {
+        if (strcmp(key, "cpu_ms") == 0) { metrics->cpuMs = value; found |= 1; }
+        else if (strcmp(key, "gpu_cull_ms") == 0) { metrics->gpuCullMs = value; found |= 2; }
+        else if (strcmp(key, "gpu_draw_ms") == 0) { metrics->gpuDrawMs = value; found |= 4; }
+        else if (strcmp(key, "allocations") == 0) { metrics->allocations = value; found |= 8; }
+    }
+    fclose(file);
+
+    if (found != 15) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Baseline %s is missing metrics", path);
+        return false;
+    }
+    return true;
+}
+
+static bool CheckMetric(const char* name, double baseline, double current, double limit) {
+    const bool ok = current <= limit;
+    printf("  %-12s baseline %9.4f  current %9.4f  limit %9.4f  %s\n", name, baseline, current, limit, ok ? "ok" : "REGRESSED");
+    return ok;
+}
+
+static bool CompareBaseline(const ReplayMetrics& baseline, const ReplayMetrics& current, double tolerance) {
+    const double scale = 1.0 + tolerance;
+    bool ok = true;
+    ok &= CheckMetric("cpu_ms", baseline.cpuMs, current.cpuMs, baseline.cpuMs * scale + ABSOLUTE_SLACK_MS);
+    ok &= CheckMetric("gpu_cull_ms", baseline.gpuCullMs, current.gpuCullMs, baseline.gpuCullMs * scale + ABSOLUTE_SLACK_MS);
+    ok &= CheckMetric("gpu_draw_ms", baseline.gpuDrawMs, current.gpuDrawMs, baseline.gpuDrawMs * scale + ABSOLUTE_SLACK_MS);
+    ok &= CheckMetric("allocations", baseline.allocations, current.allocations, baseline.allocations);
+    return ok;
+}
+
+// deviceName with everything but letters and digits replaced, usable as a file name
+static void DeviceBaselineKey(const char* deviceName, char key[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE]) {
+    uint32_t i = 0;
+    for (; deviceName[i] && i + 1 < VK_MAX_PHYSICAL_DEVICE_NAME_SIZE; i++) {
+        const char c = deviceName[i];
+        const bool keep = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        key[i] = keep ? c : '_';
+    }
+    key[i] = '\0';
+}
+
+static int Run(const ReplayOptions& options, ReplayDevice* replay, GpuScene* gpu) {
+    std::vector<uint8_t> data;
+    CaptureFileHeader fileHeader;
+    CaptureReader reader;
+    CaptureInfo info;
+    if (!LoadCapture(options.capturePath, data, &fileHeader, &reader) || !ScanCapture(reader, fileHeader, &info)) {
+        return EXIT_ERROR;
+    }
+    printf("Replaying %s: %u frames, %u instances, up to %ux%u, %u iterations\n", options.capturePath,
+           info.frameCount, info.maxInstances, info.maxExtent.width, info.maxExtent.height, options.iterations);
+
+    if (!FindReplayDevice(replay)) {
+        return EXIT_NO_DEVICE;
+    }
+    if (!CreateReplayDevice(replay, info.maxExtent) || !CreateGpuScene(gpu, &replay->context, info.maxInstances)) {
+        return EXIT_ERROR;
+    }
+
+    const int renderThreads = SDL_max(1, SDL_GetNumLogicalCPUCores() / 2);
+    JobSystem jobs((uint32_t) renderThreads - 1);
+    LinearArena frameArena = {};
+    if (!CreateArena(&frameArena, FRAME_ARENA_SIZE)) {
+        return EXIT_ERROR;
+    }
+
+    // The first pass warms caches, pipelines and the allocators and is not measured
+    std::vector<ReplayMetrics> frames;
+    frames.reserve((size_t) info.frameCount * (options.iterations + 1));
+    bool ok = ReplayCapture(replay, gpu, reader, jobs, &frameArena, frames);
+    frames.clear();
+    for (uint32_t i = 0; ok && i < options.iterations; i++) {
+        ok = ReplayCapture(replay, gpu, reader, jobs, &frameArena, frames);
+    }
+    DestroyArena(&frameArena);
+    if (!ok) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Replay of %s failed", options.capturePath);
+        return EXIT_ERROR;
+    }
+
+    if (frames.empty()) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Replay of %s produced no frames", options.capturePath);
+        return EXIT_ERROR;
+    }
+
+    const ReplayMetrics current = Summarise(frames);
+    printf("Median per frame: cpu %.4f ms, gpu cull %.4f ms, gpu draw %.4f ms, worst frame %.0f allocations\n",
+           current.cpuMs, current.gpuCullMs, current.gpuDrawMs, current.allocations);
+
+    if (options.writeBaselinePath) {
+        if (!WriteBaseline(options.writeBaselinePath, current)) {
+            return EXIT_ERROR;
+        }
+        printf("Wrote baseline %s\n", options.writeBaselinePath);
+    }
+    char deviceKey[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+    DeviceBaselineKey(replay->context.physicalDeviceProperties.deviceName, deviceKey);
+    char devicePath[1024];
+    if (options.writeBaselineDir) {
+        snprintf(devicePath, sizeof(devicePath), "%s/%s.baseline", options.writeBaselineDir, deviceKey);
+        if (!WriteBaseline(devicePath, current)) {
+            return EXIT_ERROR;
+        }
+        printf("Wrote baseline %s\n", devicePath);
+    }
+
+    const char* baselinePath = options.baselinePath;
+    if (!baselinePath && options.baselineDir) {
+        snprintf(devicePath, sizeof(devicePath), "%s/%s.baseline", options.baselineDir, deviceKey);
+        baselinePath = devicePath;
+        FILE* file = fopen(devicePath, "r");
+        if (file) {
+            fclose(file);
+        }
+        else {
+            snprintf(devicePath, sizeof(devicePath), "%s/default.baseline", options.baselineDir);
+            printf("No baseline measured on %s, using the default budget. Its timings are only a sanity bound "
+                   "and cannot catch regressions, the allocation count still can.\n", deviceKey);
+        }
+    }
+    if (baselinePath) {
+        ReplayMetrics baseline;
+        if (!ReadBaseline(baselinePath, &baseline)) {
+            return EXIT_ERROR;
+        }
+        printf("Against %s with %.0f%% tolerance:\n", baselinePath, options.tolerance * 100.0);
+        if (!CompareBaseline(baseline, current, options.tolerance)) {
+            return EXIT_REGRESSION;
+        }
+    }
+    return EXIT_PASS;
+}
+
+int main(int argc, char* argv[]) {
+    ReplayOptions options;
+    if (!ParseOptions(argc, argv, &options)) {
+        fprintf(stderr, "usage: FrameReplay capture.bin [--iterations N] [--baseline file] [--write-baseline file] "
+                        "[--baseline-dir dir] [--write-baseline-dir dir] [--tolerance 0.15]\n");
+        return EXIT_ERROR;
+    }
+    InstallMemoryHooks();
+
+    ReplayDevice replay = {};
+    GpuScene* gpu = new GpuScene();
+    const int result = Run(options, &replay, gpu);
+
+    if (replay.context.device) {
+        vkDeviceWaitIdle(replay.context.device);
+        if (gpu->cullPipeline) {
+            DestroyGpuScene(gpu, &replay.context);
+        }
+    }
+    delete gpu;
+    DestroyReplayDevice(&replay);
+    return result;
+}
@@ -0,0 +1,117 @@
+#include "scene.h"
+#include <cstring>
+#include "mathkernels.h"
+#include "SDL3/SDL_log.h"
+
+static uint32_t NextRandom(uint64_t& state) {
+    // xorshift64*
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (uint32_t) ((state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static float RandomRange(uint64_t& state, float min, float max) {
+    return min + (max - min) * ((float) NextRandom(state) / (float) UINT32_MAX);
+}
+
+static ComponentMask SceneEntityMask() {
+    return MaskOf<Position, Rotation, Scale, AngularVelocity, PreviousTransform, MeshInstance, Lifetime>();
+}
+
+// Writes the components of a freshly created entity, either directly or through a command buffer
+template<typename Target>
+static void SpawnEntity(Target& target, Entity entity, uint64_t& rng, float extent) {
+    const Position position = {
+        RandomRange(rng, -extent, extent),
+        RandomRange(rng, -extent, extent),
+        RandomRange(rng, -extent, extent)
+    };
+    target.Set(entity, position);
+    target.Set(entity, Rotation{0.0f, 0.0f, 0.0f, 1.0f});
+    // New entities appear in place rather than blending from wherever the slot was before
+    target.Set(entity, PreviousTransform{position.x, position.y, position.z, 0.0f, 0.0f, 0.0f, 1.0f});
+    target.Set(entity, Scale{RandomRange(rng, 0.5f, 2.0f)});
+    target.Set(entity, AngularVelocity{
+        RandomRange(rng, -1.0f, 1.0f),
+        RandomRange(rng, -1.0f, 1.0f),
+        RandomRange(rng, -1.0f, 1.0f)
+    });
+    target.Set(entity, MeshInstance{0, 0});
+    target.Set(entity, Lifetime{RandomRange(rng, 5.0f, 30.0f)});
+}
+
+void InitScene(Scene& scene, uint32_t entityCount) {
+    scene.spinQuery.all = MaskOf<Rotation, AngularVelocity>();
+    scene.lifetimeQuery.all = MaskOf<Lifetime>();
+    scene.previousQuery.all = MaskOf<Position, Rotation, PreviousTransform>();
+    scene.rngState = 0x9E3779B97F4A7C15ULL;
+    scene.spawnExtent = 200.0f;
+
+    const ComponentMask mask = SceneEntityMask();
+    for (uint32_t i = 0; i < entityCount; i++) {
+        const Entity entity = scene.world.CreateEntity(mask);
+        SpawnEntity(scene.world, entity, scene.rngState, scene.spawnExtent);
+    }
+    scene.world.UpdateQuery(scene.lifetimeQuery);
+    scene.commandBuffers.resize(scene.lifetimeQuery.chunks.size());
+
+    SDL_Log("Scene created with %u entities on %u threads", scene.world.EntityCount(), scene.jobs.ThreadCount());
+}
+
+void UpdateScene(Scene& scene, float dt) {
+    scene.world.ParallelForEachChunk(scene.jobs, scene.spinQuery, [dt](const ChunkView& chunk, uint32_t) {
+        IntegrateRotations(chunk.Field<Rotation>(0), chunk.Field<Rotation>(1), chunk.Field<Rotation>(2), chunk.Field<Rotation>(3),
+                           chunk.Field<AngularVelocity>(0), chunk.Field<AngularVelocity>(1), chunk.Field<AngularVelocity>(2),
+                           dt, chunk.Count());
+    });
+
+    // Expired entities are replaced by new ones. The structural changes are
+    // recorded per chunk and applied in chunk order once every chunk has been
+    // visited, so the result does not depend on which thread ran which chunk.
+    Query& query = scene.lifetimeQuery;
+    scene.world.UpdateQuery(query);
+    const uint32_t chunkCount = (uint32_t) query.chunks.size();
+    if (scene.commandBuffers.size() < chunkCount) {
+        scene.commandBuffers.resize(chunkCount);
+    }
+
+    const float extent = scene.spawnExtent;
+    const uint64_t frameSeed = NextRandom(scene.rngState);
+    scene.jobs.ParallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+        for (uint32_t c = begin; c < end; c++) {
+            const ChunkView& chunk = query.chunks[c];
+            CommandBuffer& commands = scene.commandBuffers[c];
+            const uint32_t count = chunk.Count();
+            const Entity* entities = chunk.Entities();
+            float* remaining = chunk.Field<Lifetime>(0);
+            uint64_t rng = (frameSeed ^ ((uint64_t) c << 32)) | 1;
+
+            for (uint32_t i = 0; i < count; i++) {
+                remaining[i] -= dt;
+                if (remaining[i] <= 0.0f) {
+                    commands.DestroyEntity(entities[i]);
+                    SpawnEntity(commands, commands.CreateEntity(SceneEntityMask()), rng, extent);
+                }
+            }
+        }
+    });
+
+    for (uint32_t c = 0; c < chunkCount; c++) {
+        if (!scene.commandBuffers[c].Empty()) {
+            scene.commandBuffers[c].Playback(scene.world);
+        }
+    }
+}
+
+void StorePreviousTransforms(Scene& scene) {
+    scene.world.ParallelForEachChunk(scene.jobs, scene.previousQuery, [](const ChunkView& chunk, uint32_t) {
+        const size_t bytes = sizeof(float) * chunk.Count();
+        for (uint32_t f = 0; f < 3; f++) {
+            memcpy(chunk.Field<PreviousTransform>(f), chunk.Field<Position>(f), bytes);
+        }
+        for (uint32_t f = 0; f < 4; f++) {
+            memcpy(chunk.Field<PreviousTransform>(3 + f), chunk.Field<Rotation>(f), bytes);
+        }
+    });
+}
@@ -0,0 +1,69 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <cstdint>
+#include <vector>
+#include "ecs.h"
+#include "jobs.h"
+#include "mathlib.h"
+
+// Scene components. Each one is a plain bundle of 4 byte fields so the ECS can
+// split it into per-field streams.
+struct Position {
+    float x, y, z;
+};
+
+struct Rotation {
+    float x, y, z, w;
+};
+
+struct Scale {
+    float value;
+};
+
+struct AngularVelocity {
+    float x, y, z; // axis * radians per second
+};
+
+// Position and rotation at the start of the current tick, for render interpolation
+struct PreviousTransform {
+    float x, y, z;
+    float qx, qy, qz, qw;
+};
+
+struct MeshInstance {
+    uint32_t mesh;
+    uint32_t flags;
+};
+
+struct Lifetime {
+    float remaining;
+};
+
+struct Camera {
+    Vec3 position;
+    Vec3 target;
+    float fovY;
+    float nearPlane;
+    float farPlane;
+};
+
+struct Scene {
+    explicit Scene(uint32_t workerCount = UINT32_MAX) : jobs(workerCount) {}
+
+    World world;
+    JobSystem jobs;
+    std::vector<CommandBuffer> commandBuffers; // one per lifetimeQuery chunk, played back in chunk order
+    Query spinQuery;
+    Query lifetimeQuery;
+    Query previousQuery;
+    uint64_t rngState;
+    float spawnExtent;
+};
+
+void InitScene(Scene& scene, uint32_t entityCount);
+void UpdateScene(Scene& scene, float dt);
+// Copies every Position and Rotation into PreviousTransform, call before UpdateScene
+void StorePreviousTransforms(Scene& scene);
+
+#endif //SCENE_H
@@ -4,13 +4,16 @@ shopt -s nullglob
 
 GLSLC=~/VulkanSDK/1.4.313.1/macOS/bin/glslc
 
-for filename in shaders/*.{vert,frag}; do
+mkdir -p shaders/compiled
+
+for filename in shaders/*.{vert,frag,comp}; do
   [ -f "$filename" ] || continue
 
   # Map by extension → output name
   case "$filename" in
     *.vert) out="vert.spv" ;;
     *.frag) out="frag.spv" ;;
+    *.comp) out="$(basename "$filename" .comp).spv" ;;
     *) continue ;;
   esac
 
@@ -1,20 +1,36 @@
 #version 450
 
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
 layout(location = 0) out vec3 fragColor;
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+layout(std140, set = 0, binding = 0) uniform FrameData {
+    mat4 viewProjection;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+    uvec4 counts;
+    uvec4 bucketBase[16];
+} frame;
+
+layout(std430, set = 0, binding = 1) readonly buffer Models { mat4 models[]; };
+layout(std430, set = 0, binding = 5) readonly buffer VisibleIds { uint visibleIds[]; };
+
+// Bucket base on the per-bucket draw path, 0 when firstInstance already carries it
+layout(push_constant) uniform DrawBase { uint instanceBase; } draw;
 
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+vec3 InstanceColor(uint id) {
+    uint h = id * 2654435761u;
+    return vec3(h & 255u, (h >> 8) & 255u, (h >> 16) & 255u) / 255.0 * 0.7 + 0.3;
+}
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
-}
\ No newline at end of file
+    uint id = visibleIds[draw.instanceBase + gl_InstanceIndex];
+    mat4 model = models[id];
+
+    gl_Position = frame.viewProjection * model * vec4(inPosition, 1.0);
+
+    vec3 normal = normalize(mat3(model) * inNormal);
+    float light = max(dot(normal, normalize(vec3(0.4, 1.0, 0.3))), 0.0) * 0.8 + 0.2;
+    fragColor = InstanceColor(id) * light;
+}
@@ -0,0 +1,278 @@
+#include "simulation.h"
+#include <cstring>
+#include "SDL3/SDL_keycode.h"
+#include "SDL3/SDL_log.h"
+#include "SDL3/SDL_timer.h"
+
+constexpr uint32_t SNAPSHOT_FRESH = 0x80000000u;
+constexpr uint32_t SNAPSHOT_INDEX_MASK = ~SNAPSHOT_FRESH;
+
+constexpr float ORBIT_SPEED = 0.1f;       // radians per second with no input
+constexpr float ORBIT_INPUT_SPEED = 1.0f;
+constexpr float ZOOM_SPEED = 200.0f;      // units per second
+constexpr float WHEEL_ZOOM = 25.0f;       // units per wheel step
+constexpr float MIN_ORBIT_RADIUS = 20.0f;
+constexpr float MAX_ORBIT_RADIUS = 1500.0f;
+
+TransformStreams SimSnapshot::Previous() const {
+    return {streams[8], streams[9], streams[10], streams[11], streams[12], streams[13], streams[14], streams[7]};
+}
+
+TransformStreams SimSnapshot::Current() const {
+    return {streams[0], streams[1], streams[2], streams[3], streams[4], streams[5], streams[6], streams[7]};
+}
+
+static bool CreateSnapshot(SimSnapshot* snapshot, uint32_t capacity) {
+    memset(snapshot, 0, sizeof(SimSnapshot));
+    snapshot->capacity = capacity;
+
+    // Streams start on cache line boundaries so the render side can load them wide
+    const size_t streamBytes = ((sizeof(float) * capacity + 63) / 64) * 64;
+    uint8_t* data = (uint8_t*) SDL_aligned_alloc(64, streamBytes * (SNAPSHOT_STREAM_COUNT + 1));
+    if (!data) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to allocate snapshot for %u instances", capacity);
+        return false;
+    }
+    for (uint32_t i = 0; i < SNAPSHOT_STREAM_COUNT; i++) {
+        snapshot->streams[i] = (float*) (data + streamBytes * i);
+    }
+    snapshot->meshIds = (uint32_t*) (data + streamBytes * SNAPSHOT_STREAM_COUNT);
+    return true;
+}
+
+static void DestroySnapshot(SimSnapshot* snapshot) {
+    SDL_aligned_free(snapshot->streams[0]);
+    memset(snapshot, 0, sizeof(SimSnapshot));
+}
+
+static void UpdateCamera(Simulation* sim, float dt) {
+    sim->orbitAngle += (ORBIT_SPEED + sim->orbitInput * ORBIT_INPUT_SPEED) * dt;
+    sim->orbitRadius = SDL_clamp(sim->orbitRadius + sim->zoomInput * ZOOM_SPEED * dt, MIN_ORBIT_RADIUS, MAX_ORBIT_RADIUS);
+    sim->camera.position = {
+        sim->orbitRadius * SDL_sinf(sim->orbitAngle),
+        sim->orbitHeight,
+        sim->orbitRadius * SDL_cosf(sim->orbitAngle)
+    };
+}
+
+static void ApplyInput(Simulation* sim, const InputEvent& event) {
+    const bool down = event.type == InputEvent::Type::KeyDown;
+    switch (event.type) {
+        case InputEvent::Type::KeyDown:
+        case InputEvent::Type::KeyUp:
+            if (event.key == SDLK_LEFT || event.key == SDLK_A) {
+                sim->orbitInput = down ? -1.0f : 0.0f;
+            }
+            else if (event.key == SDLK_RIGHT || event.key == SDLK_D) {
+                sim->orbitInput = down ? 1.0f : 0.0f;
+            }
+            else if (event.key == SDLK_UP || event.key == SDLK_W) {
+                sim->zoomInput = down ? -1.0f : 0.0f;
+            }
+            else if (event.key == SDLK_DOWN || event.key == SDLK_S) {
+                sim->zoomInput = down ? 1.0f : 0.0f;
+            }
+            else if (event.key == SDLK_SPACE && down) {
+                sim->paused = !sim->paused;
+            }
+            break;
+        case InputEvent::Type::MouseWheel:
+            sim->orbitRadius = SDL_clamp(sim->orbitRadius - event.wheel * WHEEL_ZOOM, MIN_ORBIT_RADIUS, MAX_ORBIT_RADIUS);
+            break;
+    }
+}
+
+void CopyChunkToSnapshot(const ChunkView& chunk, SimSnapshot* snapshot, uint32_t base, uint32_t count) {
+    const size_t bytes = sizeof(float) * count;
+    const float* sources[SNAPSHOT_STREAM_COUNT] = {
+        chunk.Field<Position>(0), chunk.Field<Position>(1), chunk.Field<Position>(2),
+        chunk.Field<Rotation>(0), chunk.Field<Rotation>(1), chunk.Field<Rotation>(2), chunk.Field<Rotation>(3),
+        chunk.Field<Scale>(0),
+        chunk.Field<PreviousTransform>(0), chunk.Field<PreviousTransform>(1), chunk.Field<PreviousTransform>(2),
+        chunk.Field<PreviousTransform>(3), chunk.Field<PreviousTransform>(4), chunk.Field<PreviousTransform>(5),
+        chunk.Field<PreviousTransform>(6)
+    };
+    for (uint32_t s = 0; s < SNAPSHOT_STREAM_COUNT; s++) {
+        memcpy(snapshot->streams[s] + base, sources[s], bytes);
+    }
+    memcpy(snapshot->meshIds + base, chunk.Field<MeshInstance, uint32_t>(0), bytes);
+}
+
+// Copies the scene's renderable state into the snapshot, one fixed range per chunk.
+// Chunks past the snapshot capacity are left out.
+static void CaptureSnapshot(Simulation* sim, SimSnapshot* snapshot, Uint64 endNS) {
+    Scene& scene = *sim->scene;
+    Query& query = sim->snapshotQuery;
+    scene.world.UpdateQuery(query);
+
+    const uint32_t maxChunks = (uint32_t) sim->chunkBase.size();
+    uint32_t chunkCount = 0;
+    uint32_t instanceCount = 0;
+    while (chunkCount < query.chunks.size() && chunkCount < maxChunks && instanceCount < snapshot->capacity) {
+        sim->chunkBase[chunkCount] = instanceCount;
+        instanceCount += query.chunks[chunkCount].Count();
+        chunkCount++;
+    }
+    if (instanceCount > snapshot->capacity) {
+        instanceCount = snapshot->capacity;
+    }
+
+    scene.jobs.ParallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+        for (uint32_t c = begin; c < end; c++) {
+            const ChunkView& chunk = query.chunks[c];
+            const uint32_t base = sim->chunkBase[c];
+            const uint32_t count = chunk.Count() < instanceCount - base ? chunk.Count() : instanceCount - base;
+            CopyChunkToSnapshot(chunk, snapshot, base, count);
+        }
+    });
+
+    snapshot->tick = sim->tick;
+    snapshot->endNS = endNS;
+    snapshot->instanceCount = instanceCount;
+}
+
+static void Publish(Simulation* sim) {
+    const uint32_t previous = sim->latest.exchange(sim->writeIndex | SNAPSHOT_FRESH, std::memory_order_acq_rel);
+    sim->writeIndex = previous & SNAPSHOT_INDEX_MASK;
+}
+
+static void RunTick(Simulation* sim, Uint64 endNS) {
+    const float dt = 1.0f / (float) SIM_TICK_RATE;
+
+    // Everything that happened before the end of the tick belongs to it, later
+    // events wait in the ring for the next one
+    const InputEvent* event;
+    while ((event = sim->input.Peek()) && event->timestampNS < endNS) {
+        ApplyInput(sim, *event);
+        sim->input.Pop();
+    }
+
+    SimSnapshot* snapshot = &sim->snapshots[sim->writeIndex];
+    snapshot->previousCamera = sim->camera;
+    UpdateCamera(sim, dt);
+    snapshot->camera = sim->camera;
+
+    StorePreviousTransforms(*sim->scene);
+    if (!sim->paused) {
+        UpdateScene(*sim->scene, dt);
+    }
+
+    sim->tick++;
+    CaptureSnapshot(sim, snapshot, endNS);
+    Publish(sim);
+}
+
+static void SimulationLoop(Simulation* sim) {
+    Uint64 nextTickNS = sim->snapshots[sim->latest.load() & SNAPSHOT_INDEX_MASK].endNS + sim->tickNS;
+
+    while (!sim->quit.load(std::memory_order_acquire)) {
+        const Uint64 now = SDL_GetTicksNS();
+        if (now < nextTickNS) {
+            SDL_DelayPrecise(nextTickNS - now);
+            continue;
+        }
+
+        // A long stall is dropped rather than replayed tick by tick
+        if (now - nextTickNS > SIM_MAX_CATCH_UP_TICKS * sim->tickNS) {
+            SDL_Log("Simulation fell %.1f ms behind, skipping ahead", (double) (now - nextTickNS) / 1e6);
+            nextTickNS = now;
+        }
+
+        RunTick(sim, nextTickNS);
+        nextTickNS += sim->tickNS;
+    }
+}
+
+bool StartSimulation(Simulation* sim, Scene* scene, uint32_t maxInstances, const Camera& camera) {
+    sim->scene = scene;
+    sim->tickNS = SDL_NS_PER_SECOND / SIM_TICK_RATE;
+    sim->tick = 0;
+    sim->snapshotQuery.all = MaskOf<Position, Rotation, Scale, PreviousTransform, MeshInstance>();
+    sim->camera = camera;
+    sim->orbitAngle = SDL_atan2f(camera.position.x, camera.position.z);
+    sim->orbitRadius = SDL_sqrtf(camera.position.x * camera.position.x + camera.position.z * camera.position.z);
+    sim->orbitHeight = camera.position.y;
+    sim->orbitInput = 0.0f;
+    sim->zoomInput = 0.0f;
+    sim->paused = false;
+
+    for (SimSnapshot& snapshot : sim->snapshots) {
+        if (!CreateSnapshot(&snapshot, maxInstances)) {
+            return false;
+        }
+    }
+
+    // The snapshot never holds more than maxInstances rows, so the chunk table is
+    // sized here for the smallest chunk capacity and the tick never grows it
+    scene->world.UpdateQuery(sim->snapshotQuery);
+    uint32_t rowsPerChunk = UINT32_MAX;
+    for (const ChunkView& chunk : sim->snapshotQuery.chunks) {
+        rowsPerChunk = SDL_min(rowsPerChunk, chunk.archetype->capacity);
+    }
+    if (rowsPerChunk == UINT32_MAX) {
+        rowsPerChunk = ECS_LANE_WIDTH;
+    }
+    sim->chunkBase.resize(maxInstances / rowsPerChunk + 1);
+
+    // Snapshot 0 holds the initial state with previous == current
+    StorePreviousTransforms(*scene);
+    sim->snapshots[0].previousCamera = camera;
+    sim->snapshots[0].camera = camera;
+    CaptureSnapshot(sim, &sim->snapshots[0], SDL_GetTicksNS());
+    sim->latest.store(0 | SNAPSHOT_FRESH);
+    sim->readIndex = 1;
+    sim->writeIndex = 2;
+
+    sim->quit.store(false);
+    sim->thread = std::thread(SimulationLoop, sim);
+    SDL_Log("Simulation running at %u Hz", SIM_TICK_RATE);
+    return true;
+}
+
+void StopSimulation(Simulation* sim) {
+    if (sim->thread.joinable()) {
+        sim->quit.store(true, std::memory_order_release);
+        sim->thread.join();
+    }
+    for (SimSnapshot& snapshot : sim->snapshots) {
+        DestroySnapshot(&snapshot);
+    }
+    if (sim->droppedInputs > 0) {
+        SDL_Log("Input ring overflowed, %llu events dropped", (unsigned long long) sim->droppedInputs);
+    }
+}
+
+bool PushInput(Simulation* sim, const InputEvent& event) {
+    if (!sim->input.TryPush(event)) {
+        sim->droppedInputs++;
+        return false;
+    }
+    return true;
+}
+
+const SimSnapshot* AcquireSnapshot(Simulation* sim) {
+    if (sim->latest.load(std::memory_order_relaxed) & SNAPSHOT_FRESH) {
+        sim->readIndex = sim->latest.exchange(sim->readIndex, std::memory_order_acq_rel) & SNAPSHOT_INDEX_MASK;
+    }
+    return &sim->snapshots[sim->readIndex];
+}
+
+float SnapshotAlpha(const Simulation* sim, const SimSnapshot* snapshot, Uint64 nowNS) {
+    if (nowNS <= snapshot->endNS) {
+        return 0.0f;
+    }
+    const float alpha = (float) (nowNS - snapshot->endNS) / (float) sim->tickNS;
+    return alpha < 1.0f ? alpha : 1.0f;
+}
+
+Camera InterpolateCamera(const SimSnapshot* snapshot, float alpha) {
+    Camera camera = snapshot->camera;
+    const Vec3 from = snapshot->previousCamera.position;
+    const Vec3 to = snapshot->camera.position;
+    camera.position = {
+        from.x + (to.x - from.x) * alpha,
+        from.y + (to.y - from.y) * alpha,
+        from.z + (to.z - from.z) * alpha
+    };
+    return camera;
+}
@@ -0,0 +1,101 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "SDL3/SDL_stdinc.h"
+#include "mathkernels.h"
+#include "scene.h"
+#include "spscqueue.h"
+
+// Fixed timestep simulation on its own thread.
+//
+// SDL_AppEvent pushes timestamped input into an SPSC ring. The simulation thread
+// applies every event that happened before the end of a tick, steps the scene by
+// exactly one tick and publishes an immutable snapshot through a triple buffer.
+// The render loop picks up the newest snapshot without blocking and blends the
+// two states it holds by how far the wall clock has moved past that tick.
+
+constexpr uint32_t SIM_TICK_RATE = 60;
+constexpr uint32_t SIM_MAX_CATCH_UP_TICKS = 5; // further behind than this and time is dropped
+constexpr uint32_t INPUT_QUEUE_CAPACITY = 256;
+constexpr uint32_t SNAPSHOT_COUNT = 3;
+
+// px, py, pz, qx, qy, qz, qw, scale of the current state, then the previous
+// state without scale
+constexpr uint32_t SNAPSHOT_STREAM_COUNT = 15;
+
+struct InputEvent {
+    enum class Type : uint32_t {
+        KeyDown,
+        KeyUp,
+        MouseWheel
+    };
+
+    Uint64 timestampNS; // SDL_GetTicksNS clock
+    Type type;
+    uint32_t key;       // SDL_Keycode
+    float wheel;
+};
+
+struct SimSnapshot {
+    uint64_t tick;
+    Uint64 endNS;       // wall clock time the tick was scheduled to end
+    Camera previousCamera;
+    Camera camera;
+    uint32_t instanceCount;
+    uint32_t capacity;
+    float* streams[SNAPSHOT_STREAM_COUNT];
+    uint32_t* meshIds;
+
+    TransformStreams Previous() const;
+    TransformStreams Current() const;
+};
+
+struct Simulation {
+    Scene* scene;
+    SpscQueue<InputEvent, INPUT_QUEUE_CAPACITY> input;
+    uint64_t droppedInputs;             // producer side only
+
+    SimSnapshot snapshots[SNAPSHOT_COUNT];
+    std::atomic<uint32_t> latest;       // newest published snapshot index, high bit set until read
+    uint32_t writeIndex;                // owned by the simulation thread
+    uint32_t readIndex;                 // owned by the render thread
+
+    // Simulation thread state
+    Uint64 tickNS;
+    uint64_t tick;
+    Query snapshotQuery;
+    std::vector<uint32_t> chunkBase;    // sized once in StartSimulation for the largest snapshot
+    Camera camera;
+    float orbitAngle;
+    float orbitRadius;
+    float orbitHeight;
+    float orbitInput;                   // -1, 0 or 1 from held keys
+    float zoomInput;
+    bool paused;
+
+    std::atomic<bool> quit;
+    std::thread thread;
+};
+
+// Copies rows [0, count) of a chunk into rows [base, base + count) of every snapshot
+// stream. The one place that defines which component field lands in which stream.
+void CopyChunkToSnapshot(const ChunkView& chunk, SimSnapshot* snapshot, uint32_t base, uint32_t count);
+
+// Captures the initial state as the first snapshot and starts the thread
+bool StartSimulation(Simulation* sim, Scene* scene, uint32_t maxInstances, const Camera& camera);
+void StopSimulation(Simulation* sim);
+
+// Producer side of the input ring, returns false and counts the event when the ring is full
+bool PushInput(Simulation* sim, const InputEvent& event);
+
+// Render thread. The snapshot stays valid until the next call.
+const SimSnapshot* AcquireSnapshot(Simulation* sim);
+// Blend factor between the snapshot's previous and current state at nowNS
+float SnapshotAlpha(const Simulation* sim, const SimSnapshot* snapshot, Uint64 nowNS);
+Camera InterpolateCamera(const SimSnapshot* snapshot, float alpha);
+
+#endif //SIMULATION_H
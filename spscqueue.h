@@ -0,0 +1,66 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+
+// Bounded lock-free ring for exactly one producer thread and one consumer thread.
+// Capacity must be a power of two. Indices increase forever and are masked on
+// access, so head == tail means empty and tail - head == Capacity means full.
+template<typename T, uint32_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer side, returns false when the ring is full
+    bool TryPush(const T& value) {
+        const uint32_t tailIndex = tail.load(std::memory_order_relaxed);
+        if (tailIndex - cachedHead == Capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (tailIndex - cachedHead == Capacity) {
+                return false;
+            }
+        }
+
+        items[tailIndex & (Capacity - 1)] = value;
+        tail.store(tailIndex + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, the returned element stays valid until Pop
+    const T* Peek() {
+        const uint32_t headIndex = head.load(std::memory_order_relaxed);
+        if (headIndex == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (headIndex == cachedTail) {
+                return nullptr;
+            }
+        }
+        return &items[headIndex & (Capacity - 1)];
+    }
+
+    // Consumer side, only valid after Peek returned an element
+    void Pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool TryPop(T& value) {
+        const T* front = Peek();
+        if (!front) {
+            return false;
+        }
+        value = *front;
+        Pop();
+        return true;
+    }
+
+private:
+    // Producer and consumer state live on separate cache lines
+    alignas(64) std::atomic<uint32_t> tail{0};
+    uint32_t cachedHead = 0;
+    alignas(64) std::atomic<uint32_t> head{0};
+    uint32_t cachedTail = 0;
+    alignas(64) T items[Capacity];
+};
+
+#endif //SPSCQUEUE_H
@@ -8,9 +8,9 @@
 #include "SDL3/SDL_filesystem.h"
 #include "SDL3/SDL_log.h"
 #include <limits.h>
+#include "memory.h"
 
-char* Uint32ToBinary(Uint32 num) {
-    char* result = new char[33];
+char* Uint32ToBinary(Uint32 num, char result[33]) {
     result[32] = '\0';
 
     for (int i = 31; i >= 0; i--) {
@@ -26,7 +26,7 @@ char* Uint32ToBinary(Uint32 num) {
     return result;
 }
 
-char *LoadFile(const char *directory, size_t &length) {
+char *LoadFile(const char *directory, size_t &length, LinearArena* arena) {
     FILE* shaderFile = fopen(directory, "rb");
     if (!shaderFile) {
         perror("fopen failed");
@@ -36,8 +36,14 @@ char *LoadFile(const char *directory, size_t &length) {
     fseek(shaderFile, 0, SEEK_END);
     length = ftell(shaderFile);
     rewind(shaderFile);
-    char* buffer = (char*)malloc(length);
-    fread(buffer, length, 1, shaderFile);
+    char* buffer = arena ? (char*)ArenaAlloc(arena, length) : (char*)malloc(length);
+    if (!buffer || fread(buffer, length, 1, shaderFile) != 1) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to read: %s", directory);
+        if (!arena) {
+            free(buffer);
+        }
+        buffer = nullptr;
+    }
     fclose(shaderFile);
 
     return buffer;
@@ -3,8 +3,13 @@
 
 #include "SDL3/SDL_stdinc.h"
 
-char* Uint32ToBinary(Uint32 num);
-char *LoadFile(const char *directory, size_t &length);
+struct LinearArena;
+
+// Writes the 32 bit binary representation and a terminator into result
+char* Uint32ToBinary(Uint32 num, char result[33]);
+// The returned buffer is malloc'd when arena is null and must be freed by the caller,
+// otherwise it lives in the arena
+char *LoadFile(const char *directory, size_t &length, LinearArena* arena = nullptr);
 bool StringContains(const char* searchString, const char* target);
 
 #endif //UTILITY_H
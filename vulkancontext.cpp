@@ -0,0 +1,205 @@
+#include "vulkancontext.h"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "SDL3/SDL_log.h"
+#include "memory.h"
+#include "utility.h"
+
+uint32_t FindMemoryType(const VulkanContext* context, uint32_t typeBits, VkMemoryPropertyFlags properties) {
+    for (uint32_t i = 0; i < context->memoryProperties.memoryTypeCount; i++) {
+        if ((typeBits & (1u << i)) && (context->memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    return UINT32_MAX;
+}
+
+bool CreateBuffer(const VulkanContext* context, VkDeviceSize size, VkBufferUsageFlags usage,
+                  VkMemoryPropertyFlags properties, VkBuffer* buffer, VkDeviceMemory* memory,
+                  GpuMemoryCategory category) {
+    VkBufferCreateInfo bufferInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+    };
+
+    if (vkCreateBuffer(context->device, &bufferInfo, nullptr, buffer) != VK_SUCCESS) {
+        SDL_Log("Create Buffer Failed");
+        return false;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(context->device, *buffer, &requirements);
+
+    const uint32_t memoryType = FindMemoryType(context, requirements.memoryTypeBits, properties);
+    if (memoryType == UINT32_MAX) {
+        SDL_Log("No suitable memory type for buffer");
+        vkDestroyBuffer(context->device, *buffer, nullptr);
+        return false;
+    }
+
+    VkMemoryAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = memoryType
+    };
+
+    if (TrackedAllocateMemory(context->memoryTracker, context->device, &allocateInfo, category, memory) != VK_SUCCESS) {
+        SDL_Log("Allocate Buffer Memory Failed");
+        vkDestroyBuffer(context->device, *buffer, nullptr);
+        return false;
+    }
+
+    vkBindBufferMemory(context->device, *buffer, *memory, 0);
+    return true;
+}
+
+void DestroyBuffer(const VulkanContext* context, VkBuffer buffer, VkDeviceMemory memory) {
+    vkDestroyBuffer(context->device, buffer, nullptr);
+    TrackedFreeMemory(context->memoryTracker, context->device, memory);
+}
+
+bool UploadToBuffer(const VulkanContext* context, VkBuffer destination, const void* data, VkDeviceSize size) {
+    VkBuffer staging;
+    VkDeviceMemory stagingMemory;
+    if (!CreateBuffer(context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging, &stagingMemory,
+                      GpuMemoryCategory::Staging)) {
+        return false;
+    }
+
+    void* mapped;
+    vkMapMemory(context->device, stagingMemory, 0, size, 0, &mapped);
+    memcpy(mapped, data, size);
+    vkUnmapMemory(context->device, stagingMemory);
+
+    VkCommandBufferAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = context->commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1
+    };
+
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers(context->device, &allocateInfo, &commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+    };
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    VkBufferCopy region = {
+        .srcOffset = 0,
+        .dstOffset = 0,
+        .size = size
+    };
+    vkCmdCopyBuffer(commandBuffer, staging, destination, 1, &region);
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer
+    };
+    vkQueueSubmit(context->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    vkQueueWaitIdle(context->graphicsQueue);
+
+    vkFreeCommandBuffers(context->device, context->commandPool, 1, &commandBuffer);
+    DestroyBuffer(context, staging, stagingMemory);
+    return true;
+}
+
+static void DestroyObject(const VulkanContext* context, const DeferredDeletion& deletion) {
+    const VkDevice device = context->device;
+    switch (deletion.type) {
+        case VK_OBJECT_TYPE_BUFFER:
+            vkDestroyBuffer(device, (VkBuffer) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_DEVICE_MEMORY:
+            TrackedFreeMemory(context->memoryTracker, device, (VkDeviceMemory) deletion.handle);
+            break;
+        case VK_OBJECT_TYPE_IMAGE:
+            vkDestroyImage(device, (VkImage) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_IMAGE_VIEW:
+            vkDestroyImageView(device, (VkImageView) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_FRAMEBUFFER:
+            vkDestroyFramebuffer(device, (VkFramebuffer) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_SEMAPHORE:
+            vkDestroySemaphore(device, (VkSemaphore) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_PIPELINE:
+            vkDestroyPipeline(device, (VkPipeline) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+            vkDestroySwapchainKHR(device, (VkSwapchainKHR) deletion.handle, nullptr);
+            break;
+        default:
+            SDL_Log("Deferred deletion of unsupported object type %d", (int) deletion.type);
+            break;
+    }
+}
+
+static void FlushFrameDeletions(VulkanContext* context, FrameResources* frame) {
+    for (uint32_t i = 0; i < frame->deletionCount; i++) {
+        DestroyObject(context, frame->deletions[i]);
+    }
+    frame->deletionCount = 0;
+}
+
+void DeferDestroy(VulkanContext* context, VkObjectType type, uint64_t handle) {
+    if (handle == 0) {
+        return;
+    }
+
+    // The last submitted frame is the newest one that can still use the handle.
+    // Its fence is waited on before that slot is recorded again.
+    FrameResources* frame = &context->frames[context->lastSubmittedSlot];
+    if (frame->deletionCount == MAX_DEFERRED_DELETIONS) {
+        vkDeviceWaitIdle(context->device);
+        FlushAllDeferredDeletions(context);
+    }
+    frame->deletions[frame->deletionCount++] = DeferredDeletion{type, handle};
+}
+
+void FlushDeferredDeletions(VulkanContext* context, uint32_t frameSlot) {
+    FlushFrameDeletions(context, &context->frames[frameSlot]);
+}
+
+void FlushAllDeferredDeletions(VulkanContext* context) {
+    for (FrameResources& frame : context->frames) {
+        FlushFrameDeletions(context, &frame);
+    }
+}
+
+VkShaderModule CreateShaderModule(const VkDevice* device, const char* code, size_t codeLength) {
+    VkShaderModuleCreateInfo shaderModuleCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = codeLength,
+        .pCode = (const uint32_t*)code
+    };
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(*device, &shaderModuleCreateInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module!");
+    }
+
+    return shaderModule;
+}
+
+VkShaderModule LoadShaderModule(const VkDevice* device, const char* path) {
+    ScratchScope scratch(ScratchArena());
+    size_t length;
+    char* code = LoadFile(path, length, ScratchArena());
+    if (!code) {
+        throw std::runtime_error("failed to load shader!");
+    }
+
+    return CreateShaderModule(device, code, length);
+}
@@ -0,0 +1,86 @@
+#ifndef VULKANCONTEXT_H
+#define VULKANCONTEXT_H
+
+#include <vulkan/vulkan.h>
+#include "gpumemory.h"
+
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+constexpr uint32_t MAX_DEFERRED_DELETIONS = 64;
+constexpr uint32_t MAX_SWAPCHAIN_IMAGES = 8;
+
+// A Vulkan handle retired while a frame in flight may still reference it
+struct DeferredDeletion {
+    VkObjectType type;
+    uint64_t handle;
+};
+
+struct FrameResources {
+    VkCommandBuffer commandBuffer;
+    VkSemaphore imageAvailable;
+    VkFence inFlight;
+    // Destroyed once inFlight signals for the next time this slot comes around
+    DeferredDeletion deletions[MAX_DEFERRED_DELETIONS];
+    uint32_t deletionCount;
+};
+
+// Vulkan objects that live for the whole run. Swapchain dependent objects are
+// rebuilt together when the window is resized.
+struct VulkanContext {
+    VkInstance instance;
+    VkSurfaceKHR surface;
+    VkPhysicalDevice physicalDevice;
+    VkPhysicalDeviceProperties physicalDeviceProperties;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    VkDevice device;
+    VkQueue graphicsQueue;
+    VkQueue presentQueue;
+    uint32_t graphicsFamily;
+    uint32_t presentFamily;
+    bool supportsDrawIndirectCount;
+    bool supportsDrawIndirectFirstInstance; // non-zero firstInstance in indirect commands
+    GpuMemoryTracker* memoryTracker; // every device allocation goes through this
+
+    VkSwapchainKHR swapchain;
+    VkSurfaceFormatKHR surfaceFormat;
+    VkPresentModeKHR presentMode;
+    VkExtent2D extent;
+    uint32_t swapchainImageCount;
+    VkImage swapchainImages[MAX_SWAPCHAIN_IMAGES];
+    VkImageView swapchainImageViews[MAX_SWAPCHAIN_IMAGES];
+    VkFramebuffer framebuffers[MAX_SWAPCHAIN_IMAGES];
+    VkSemaphore renderFinished[MAX_SWAPCHAIN_IMAGES]; // one per swapchain image
+
+    VkFormat depthFormat;
+    VkImage depthImage;
+    VkDeviceMemory depthMemory;
+    VkImageView depthImageView;
+
+    VkRenderPass renderPass;
+    VkCommandPool commandPool;
+    FrameResources frames[MAX_FRAMES_IN_FLIGHT];
+    uint32_t frameIndex;
+    uint32_t lastSubmittedSlot;
+};
+
+uint32_t FindMemoryType(const VulkanContext* context, uint32_t typeBits, VkMemoryPropertyFlags properties);
+
+bool CreateBuffer(const VulkanContext* context, VkDeviceSize size, VkBufferUsageFlags usage,
+                  VkMemoryPropertyFlags properties, VkBuffer* buffer, VkDeviceMemory* memory,
+                  GpuMemoryCategory category = GpuMemoryCategory::Buffer);
+void DestroyBuffer(const VulkanContext* context, VkBuffer buffer, VkDeviceMemory memory);
+
+// Copies data into a device local buffer through a temporary staging buffer and waits for it
+bool UploadToBuffer(const VulkanContext* context, VkBuffer destination, const void* data, VkDeviceSize size);
+
+// Queues a handle for destruction after the most recently submitted frame has finished.
+// Falls back to waiting for the device when the slot's queue is full.
+void DeferDestroy(VulkanContext* context, VkObjectType type, uint64_t handle);
+// Call right after waiting on the slot's fence
+void FlushDeferredDeletions(VulkanContext* context, uint32_t frameSlot);
+// Destroys everything still queued, the device must be idle
+void FlushAllDeferredDeletions(VulkanContext* context);
+
+VkShaderModule CreateShaderModule(const VkDevice* device, const char* code, size_t codeLength);
+VkShaderModule LoadShaderModule(const VkDevice* device, const char* path);
+
+#endif //VULKANCONTEXT_H